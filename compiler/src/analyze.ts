@@ -11,9 +11,10 @@ import {
   getFoundFns, getExpectedFns, getCurrentFn, AMBIG_NIL, createVec
 } from './typeload'
 import * as Enum from './enum';
+import { BuildStats, passStart, addUnitTime } from './stats';
 
 export {
-  analyze, newScope, ensureExprValid, FnContext, Program, Fn, Inst,
+  analyze, analyzeUnit, newScope, ensureExprValid, FnContext, Program, Fn, Inst, boundsChecks, visitInsts,
   StructInitField, FnCall, Expr, LeftExpr, Mode, FnImpl, GlobalImpl,
   MacroArg, CondBody
 }
@@ -77,6 +78,7 @@ type Inst = { tag: 'if', val: CondBody, position: Position }
   | { tag: 'assign', val: Assign, position: Position }
   | { tag: 'include', val: Include, position: Position }
   | { tag: 'defer', val: Inst[], position: Position }
+  | { tag: 'arena', val: Inst[], position: Position }
 
 interface FnCall {
   fn: LeftExpr
@@ -137,6 +139,7 @@ interface Index {
   implReturnsPointer: boolean
   verifyFn: Fn | null
   verifyFnType: Type | null
+  unchecked: boolean
 }
 
 type Mode = 'C' | 'global' | 'none' | 'iter' | 'link' | 'field_iter' | 'generic_const'; 
@@ -148,7 +151,8 @@ type LeftExpr = { tag: 'dot', val: DotOp, type: Type }
 
 function analyze(
   units: Parse.ProgramUnit[],
-  symbols: UnitSymbols[]
+  symbols: UnitSymbols[],
+  stats: BuildStats | null = null
 ): Program | null {
 
   let validProgram: Program | null = {
@@ -157,32 +161,36 @@ function analyze(
   };
 
   for (let i = 0; i < units.length; i++) {
-    let unitFns: FnImpl[] | null = null;
-    let unitGlobals: GlobalImpl[] | null = null;
-    if (validProgram != null) {
-      unitGlobals = analyzeUnitGlobals(symbols[i], units[i]);
-    }
-
-    if (validProgram != null) {
-      unitFns = analyzeUnitFns(symbols[i], units[i]); 
-    }
-
-    if (unitFns == null || unitGlobals == null) {
+    if (validProgram == null) break;
+    let start = passStart();
+    let unitProgram = analyzeUnit(symbols[i], units[i]);
+    addUnitTime(stats, units[i].fullName, 'analyze', start);
+    if (unitProgram == null) {
       validProgram = null;
-    } 
-    else if (validProgram != null) {
-      validProgram.fns.push(...unitFns);
-      validProgram.globals.push(...unitGlobals);
+    }
+    else {
+      validProgram.fns.push(...unitProgram.fns);
+      validProgram.globals.push(...unitProgram.globals);
     }
   }
 
   return validProgram;
 }
 
+// a unit is analyzed against the symbols of the whole program, so one can be
+// checked again on its own while the declarations it sees stay the same
+function analyzeUnit(symbols: UnitSymbols, unit: Parse.ProgramUnit): Program | null {
+  let globals = analyzeUnitGlobals(symbols, unit);
+  let fns = analyzeUnitFns(symbols, unit);
+  if (fns == null || globals == null) return null;
+  return { fns, globals };
+}
+
 function analyzeUnitGlobals(symbols: UnitSymbols, unit: Parse.ProgramUnit): GlobalImpl[] | null {
   let nullScope: FnContext = {
     returnType: NIL,
     inLoop: false,
+    inArena: false,
     generics: new Set(),
     genericConsts: new Set(),
     typeScope: [],
@@ -283,6 +291,7 @@ function analyzeFn(
   if (allElifFollowIf(fn.body) == false) return null;
   let body = analyzeInstBody(symbols, fn.body, scope);
   if (body == null) return null;
+  markLoopsInBounds(body);
 
   if (fn.mode != 'decl' && !typeApplicable(NIL, scope.returnType, false) && allPaths(body, 'return') == false) {
     logError(fn.position, 'function does not always return');
@@ -326,7 +335,7 @@ function allElifFollowIf(body: Parse.Inst[]): boolean {
     if (inst.tag == 'if' || inst.tag == 'for_in' || inst.tag == 'elif' || inst.tag == 'while') {
       subBody = inst.val.body;
     }
-    if (inst.tag == 'else') {
+    if (inst.tag == 'else' || inst.tag == 'arena') {
       subBody = inst.val;
     }
 
@@ -384,7 +393,16 @@ function analyzeInstBody(
   scope: FnContext,
 ): Inst[] | null {
   enterScope(scope);
+  let newBody = analyzeInsts(symbols, body, scope);
+  exitScope(scope);
+  return newBody;
+}
 
+function analyzeInsts(
+  symbols: UnitSymbols,
+  body: Parse.Inst[],
+  scope: FnContext,
+): Inst[] | null {
   let newBody: Inst[] = [];
   let isValid = true;
   for (let i = 0; i < body.length; i++) {
@@ -403,7 +421,6 @@ function analyzeInstBody(
     else if (newBody != null) newBody.push(inst);
   }
 
-  exitScope(scope);
   if (isValid) {
     return newBody;
   }
@@ -488,6 +505,14 @@ function analyzeInst(
     return { tag: 'defer', val: body, position: inst.position };
   }
 
+  if (inst.tag == 'arena') {
+    if (arenaHasExit(inst.val, false)) {
+      logError(inst.position, 'can not ret, break or continue out of an arena block');
+      return null;
+    }
+    return analyzeArena(symbols, inst, scope);
+  }
+
   if (inst.tag == 'for_in') {
     let iterExpr = ensureExprValid(symbols, inst.val.iter, null, scope, inst.position);
     if (iterExpr == null) return null;
@@ -564,7 +589,7 @@ function analyzeInst(
     }
     else if (inst.val.tag == 'try' || inst.val.tag == 'fn_call') {
       let exprTuple = ensureExprValid(symbols, inst.val, NIL, scope, inst.position);
-      if (exprTuple == null) return null;
+      if (exprTuple == null || !checkFreeze(scope, exprTuple, inst.position)) return null;
       return { tag: 'expr', val: exprTuple, position: inst.position }
     }
 
@@ -594,6 +619,7 @@ function analyzeInst(
       return null;
     }
 
+    if (!checkFreeze(scope, expr, inst.position)) return null;
     let leftExpr: LeftExpr = { tag: 'var', mode: 'none', unit: null, val: inst.val.name, type: declareType };
     Enum.remove(scope.variantScope, leftExpr);
     if (expr != null) Enum.recursiveAddExpr(scope.variantScope, leftExpr, expr);
@@ -654,7 +680,7 @@ function analyzeInst(
     }
 
     let expr = ensureExprValid(symbols, inst.val.expr, to.type, scope, inst.position);
-    if (expr == null) return null;
+    if (expr == null || !checkFreeze(scope, expr, inst.position)) return null;
 
     if (inst.val.op == '=') Enum.recursiveAddExpr(scope.variantScope, to, expr);
     return { tag: 'assign', val: { to: to , expr: expr, op: inst.val.op }, position: inst.position };
@@ -664,6 +690,421 @@ function analyzeInst(
   return null;
 }
 
+function arenaHasExit(body: Parse.Inst[], inLoop: boolean): boolean {
+  for (let inst of body) {
+    if (inst.tag == 'return' || inst.tag == 'return_void') return true;
+    if ((inst.tag == 'break' || inst.tag == 'continue') && !inLoop) return true;
+    if (inst.tag == 'if' || inst.tag == 'elif') {
+      if (arenaHasExit(inst.val.body, inLoop)) return true;
+    }
+    if (inst.tag == 'while' || inst.tag == 'for_in') {
+      if (arenaHasExit(inst.val.body, true)) return true;
+    }
+    if (inst.tag == 'else' || inst.tag == 'defer' || inst.tag == 'arena') {
+      if (arenaHasExit(inst.val, inLoop)) return true;
+    }
+  }
+  return false;
+}
+
+interface Visitor {
+  inst?: (inst: Inst) => void
+  expr?: (expr: Expr) => void
+  leftExpr?: (leftExpr: LeftExpr) => void
+}
+
+// calls the visitor on every inst, expr and left expr in the body. an inst's
+// own exprs are visited before the bodies nested in it
+function visitInsts(body: Inst[], visitor: Visitor) {
+  for (let inst of body) {
+    if (visitor.inst) visitor.inst(inst);
+    if (inst.tag == 'if' || inst.tag == 'elif' || inst.tag == 'while') {
+      visitExpr(inst.val.cond, visitor);
+      visitInsts(inst.val.body, visitor);
+    }
+    else if (inst.tag == 'for_in') {
+      visitExpr(inst.val.iter, visitor);
+      visitInsts(inst.val.body, visitor);
+    }
+    else if (inst.tag == 'else' || inst.tag == 'defer' || inst.tag == 'arena') {
+      visitInsts(inst.val, visitor);
+    }
+    else if (inst.tag == 'expr' || inst.tag == 'return') {
+      if (inst.val != null) visitExpr(inst.val, visitor);
+    }
+    else if (inst.tag == 'declare') {
+      visitExpr(inst.val.expr, visitor);
+    }
+    else if (inst.tag == 'assign') {
+      visitLeftExpr(inst.val.to, visitor);
+      visitExpr(inst.val.expr, visitor);
+    }
+  }
+}
+
+function visitExpr(expr: Expr, visitor: Visitor) {
+  if (visitor.expr) visitor.expr(expr);
+  if (expr.tag == 'bin') {
+    visitExpr(expr.val.left, visitor);
+    visitExpr(expr.val.right, visitor);
+  }
+  else if (expr.tag == 'not' || expr.tag == 'try' || expr.tag == 'assert' || expr.tag == 'cast') {
+    visitExpr(expr.val, visitor);
+  }
+  else if (expr.tag == 'fn_call') {
+    visitLeftExpr(expr.val.fn, visitor);
+    for (let arg of expr.val.exprs) visitExpr(arg, visitor);
+  }
+  else if (expr.tag == 'macro_call') {
+    for (let arg of expr.val.args) {
+      if (arg.tag == 'expr') visitExpr(arg.val, visitor);
+    }
+  }
+  else if (expr.tag == 'struct_init') {
+    for (let field of expr.val) visitExpr(field.expr, visitor);
+  }
+  else if (expr.tag == 'list_init' || expr.tag == 'fmt_str') {
+    for (let item of expr.val) visitExpr(item, visitor);
+  }
+  else if (expr.tag == 'enum_init') {
+    if (expr.fieldExpr != null) visitExpr(expr.fieldExpr, visitor);
+  }
+  else if (expr.tag == 'is') {
+    visitLeftExpr(expr.left, visitor);
+  }
+  else if (expr.tag == 'left_expr' || expr.tag == 'ptr') {
+    visitLeftExpr(expr.val, visitor);
+  }
+}
+
+function visitLeftExpr(leftExpr: LeftExpr, visitor: Visitor) {
+  if (visitor.leftExpr) visitor.leftExpr(leftExpr);
+  if (leftExpr.tag == 'dot') {
+    visitExpr(leftExpr.val.left, visitor);
+  }
+  else if (leftExpr.tag == 'index') {
+    visitExpr(leftExpr.val.var, visitor);
+    visitExpr(leftExpr.val.index, visitor);
+  }
+}
+
+// types whose int index can skip the bounds check. the std types are
+// indexed through their base pointer once the check is gone
+function hasUncheckedIndex(type: Type): boolean {
+  if (type.tag == 'ptr') return true;
+  if (type.tag != 'struct' || type.val.template.unit != 'std/core') return false;
+  let name = type.val.template.name;
+  return name == 'vec' || name == 'Arr' || name == 'seg' || name == 'str' || name == 'Fmt';
+}
+
+// the local x of a range loop over c:x.len, with c a constant that is not
+// negative. null when the loop is over anything else
+function rangeLenVar(iter: Expr): string | null {
+  if (iter.tag != 'struct_init' || !typeEq(iter.type, RANGE)) return null;
+  let start = iter.val[0].expr;
+  let end = iter.val[1].expr;
+  if (start.tag != 'bin' || start.val.left.tag != 'int_const' || !/^[0-9]+$/.test(start.val.left.val)) return null;
+  if (end.tag != 'left_expr' || end.val.tag != 'dot' || end.val.val.varName != 'len') return null;
+
+  // a link or global could be changed through another name while the loop runs
+  let container = end.val.val.left;
+  if (container.tag != 'left_expr' || container.val.tag != 'var' || container.val.mode != 'none') return null;
+  if (container.type.tag == 'ptr' || !hasUncheckedIndex(container.type)) return null;
+  return container.val.val;
+}
+
+function isVarOrField(leftExpr: LeftExpr, name: string): boolean {
+  while (leftExpr.tag == 'dot') {
+    if (leftExpr.val.left.tag != 'left_expr') return false;
+    leftExpr = leftExpr.val.left.val;
+  }
+  return leftExpr.tag == 'var' && leftExpr.val == name;
+}
+
+// whether the body could change name or one of its fields, by assigning it,
+// taking its address, passing it by reference or declaring over it. writes
+// to its elements leave its length alone
+function bodyChangesVar(body: Inst[], name: string): boolean {
+  let changes = false;
+  visitInsts(body, {
+    inst: inst => {
+      if (inst.tag == 'declare' && inst.val.name == name) changes = true;
+      if (inst.tag == 'for_in' && inst.val.varName == name) changes = true;
+      if (inst.tag == 'assign' && isVarOrField(inst.val.to, name)) changes = true;
+      if (inst.tag == 'include' && inst.val.lines.some(line => line.includes('_' + name))) changes = true;
+    },
+    expr: expr => {
+      if (expr.tag == 'ptr' && isVarOrField(expr.val, name)) changes = true;
+      if (expr.tag == 'fn_call' && expr.val.fn.type.tag == 'fn') {
+        let paramTypes = expr.val.fn.type.paramTypes;
+        for (let i = 0; i < expr.val.exprs.length && i < paramTypes.length; i++) {
+          let arg = expr.val.exprs[i];
+          if (paramTypes[i].tag == 'link' && arg.tag == 'left_expr' && isVarOrField(arg.val, name)) changes = true;
+        }
+      }
+    }
+  });
+  return changes;
+}
+
+// runs once the whole fn is analyzed. a pointer to x taken anywhere in the
+// fn, before the loop or after it in an outer loop, could change x.len while
+// a loop over it runs, so those loops keep their checks
+function markLoopsInBounds(body: Inst[]) {
+  let pointers: LeftExpr[] = [];
+  let includeLines: string[] = [];
+  visitInsts(body, {
+    inst: inst => {
+      if (inst.tag == 'include') includeLines.push(...inst.val.lines);
+    },
+    expr: expr => {
+      if (expr.tag == 'ptr') pointers.push(expr.val);
+    }
+  });
+
+  visitInsts(body, {
+    inst: inst => {
+      if (inst.tag != 'for_in') return;
+      let container = rangeLenVar(inst.val.iter);
+      if (container == null) return;
+      let addressOf = new RegExp('&\\s*_' + container + '\\b');
+      if (pointers.some(p => isVarOrField(p, container)) || includeLines.some(line => addressOf.test(line))) return;
+      if (bodyChangesVar(inst.val.body, container) || bodyChangesVar(inst.val.body, inst.val.varName)) return;
+      markInBounds(inst.val.body, container, inst.val.varName);
+    }
+  });
+}
+
+// in a loop over 0:x.len where neither x nor i change, x[i] is always in
+// bounds and is left unchecked
+function markInBounds(body: Inst[], container: string, iterVar: string) {
+  visitInsts(body, {
+    leftExpr: leftExpr => {
+      if (leftExpr.tag != 'index') return;
+      let v = leftExpr.val.var;
+      let index = leftExpr.val.index;
+      if (v.tag == 'left_expr' && v.val.tag == 'var' && v.val.val == container
+        && index.tag == 'left_expr' && index.val.tag == 'var' && index.val.val == iterVar && index.val.mode == 'iter'
+      ) {
+        leftExpr.val.unchecked = true;
+      }
+    }
+  });
+}
+
+// the bounds checks left in a fn, by the line of the inst they are in, and
+// the number of indexes that were proven or marked as not needing one
+function boundsChecks(fn: FnImpl): { checked: number[], unchecked: number } {
+  let checked: number[] = [];
+  let unchecked = 0;
+  let line = 0;
+  visitInsts(fn.body, {
+    inst: inst => { line = inst.position.line },
+    leftExpr: leftExpr => {
+      if (leftExpr.tag != 'index' || leftExpr.val.var.type.tag == 'ptr' || !hasUncheckedIndex(leftExpr.val.var.type)) return;
+      if (!typeApplicable(leftExpr.val.index.type, INT, false)) return;
+      if (leftExpr.val.unchecked) unchecked += 1;
+      else checked.push(line);
+    }
+  });
+  return { checked, unchecked };
+}
+
+function getRootVar(expr: Expr): string | null {
+  while (expr.tag == 'left_expr') {
+    let left = expr.val;
+    if (left.tag == 'var') return left.mode == 'none' || left.mode == 'link' ? left.val : null;
+    if (left.tag == 'dot') expr = left.val.left;
+    else if (left.tag == 'index') expr = left.val.var;
+    else return null;
+  }
+  return null;
+}
+
+// outer locals that are mutated through a reference
+function getExprEscapes(expr: Expr, declared: Set<string>, escapes: Set<string>) {
+  if (expr.tag == 'fn_call') {
+    let fnType = expr.val.fn.type;
+    for (let i = 0; i < expr.val.exprs.length; i++) {
+      let arg = expr.val.exprs[i];
+      if (fnType.tag == 'fn' && i < fnType.paramTypes.length && fnType.paramTypes[i].tag == 'link') {
+        let name = getRootVar(arg);
+        if (name != null && !declared.has(name)) escapes.add(name);
+      }
+      getExprEscapes(arg, declared, escapes);
+    }
+  }
+  else if (expr.tag == 'bin') {
+    getExprEscapes(expr.val.left, declared, escapes);
+    getExprEscapes(expr.val.right, declared, escapes);
+  }
+  else if (expr.tag == 'not' || expr.tag == 'try' || expr.tag == 'assert' || expr.tag == 'cast') {
+    getExprEscapes(expr.val, declared, escapes);
+  }
+  else if (expr.tag == 'list_init' || expr.tag == 'fmt_str') {
+    for (let inner of expr.val) getExprEscapes(inner, declared, escapes);
+  }
+  else if (expr.tag == 'struct_init') {
+    for (let field of expr.val) getExprEscapes(field.expr, declared, escapes);
+  }
+  else if (expr.tag == 'enum_init') {
+    if (expr.fieldExpr != null) getExprEscapes(expr.fieldExpr, declared, escapes);
+  }
+  else if (expr.tag == 'ptr') {
+    // the address of an outer local lets anything change it
+    let name = getRootVar({ tag: 'left_expr', val: expr.val, type: expr.val.type });
+    if (name != null && !declared.has(name)) escapes.add(name);
+    getExprEscapes({ tag: 'left_expr', val: expr.val, type: expr.val.type }, declared, escapes);
+  }
+  else if (expr.tag == 'left_expr') {
+    if (expr.val.tag == 'dot') getExprEscapes(expr.val.val.left, declared, escapes);
+    else if (expr.val.tag == 'index') {
+      getExprEscapes(expr.val.val.var, declared, escapes);
+      getExprEscapes(expr.val.val.index, declared, escapes);
+    }
+  }
+}
+
+// locals assigned or passed by reference in the body that were declared outside of it
+function getArenaEscapes(body: Inst[], declared: Set<string>, escapes: Set<string>) {
+  for (let inst of body) {
+    if (inst.tag == 'declare') {
+      getExprEscapes(inst.val.expr, declared, escapes);
+      declared.add(inst.val.name);
+    }
+    else if (inst.tag == 'assign') {
+      let name = getRootVar({ tag: 'left_expr', val: inst.val.to, type: inst.val.to.type });
+      if (name != null && !declared.has(name)) escapes.add(name);
+      getExprEscapes(inst.val.expr, declared, escapes);
+    }
+    else if (inst.tag == 'expr' || inst.tag == 'return') {
+      if (inst.val != null) getExprEscapes(inst.val, declared, escapes);
+    }
+    else if (inst.tag == 'if' || inst.tag == 'elif' || inst.tag == 'while') {
+      getExprEscapes(inst.val.cond, declared, escapes);
+      getArenaEscapes(inst.val.body, new Set(declared), escapes);
+    }
+    else if (inst.tag == 'for_in') {
+      let innerDeclared = new Set(declared);
+      innerDeclared.add(inst.val.varName);
+      getArenaEscapes(inst.val.body, innerDeclared, escapes);
+    }
+    else if (inst.tag == 'else' || inst.tag == 'defer' || inst.tag == 'arena') {
+      getArenaEscapes(inst.val, new Set(declared), escapes);
+    }
+  }
+}
+
+// an arena block runs its body on a scratch arena and then releases it back
+// to where it was on entry. outer values the body may have changed are
+// realloc'd in to the enclosing arena before the release, the body is a block
+// of its own so its defers run before that
+function analyzeArena(
+  symbols: UnitSymbols,
+  inst: Parse.Inst,
+  scope: FnContext
+): Inst | null {
+  if (inst.tag != 'arena') return null;
+  let position = inst.position;
+  let varExpr = (name: string): Parse.Expr => {
+    return { tag: 'left_expr', val: { tag: 'var', val: name }, position };
+  }
+  let fnCall = (name: string, exprs: Parse.Expr[]): Parse.Expr => {
+    return { tag: 'fn_call', val: { fn: { tag: 'var', val: name }, exprs, exprNames: exprs.map(_ => null) }, position };
+  }
+  let allocType: Parse.Type = { tag: 'basic', val: 'BumpAlloc', unitMode: 'none', unit: 'std/core' };
+
+  let enter: Parse.Inst[] = [
+    { tag: 'declare', val: { t: allocType, name: '__arenaParent', expr: varExpr('bp') }, position },
+    { tag: 'assign', val: { op: '=', to: { tag: 'var', val: 'bp' }, expr: fnCall('enterArena', [varExpr('__arenaParent')]) }, position },
+    { tag: 'declare', val: { t: allocType, name: '__arenaMark', expr: varExpr('bp') }, position }
+  ];
+
+  enterScope(scope);
+  let inArena = scope.inArena;
+  scope.inArena = true;
+  let body = analyzeInsts(symbols, [...enter, ...inst.val], scope);
+  scope.inArena = inArena;
+  if (body == null) {
+    exitScope(scope);
+    return null;
+  }
+
+  // an err from try returns straight out of the fn, past the release
+  let tryPosition: Position | null = null;
+  let instPosition = position;
+  visitInsts(body.slice(enter.length), {
+    inst: inner => instPosition = inner.position,
+    expr: expr => { if (expr.tag == 'try' && tryPosition == null) tryPosition = instPosition }
+  });
+  if (tryPosition != null) {
+    logError(tryPosition, 'can not try in an arena block');
+    exitScope(scope);
+    return null;
+  }
+
+  let escapes: Set<string> = new Set();
+  getArenaEscapes(body.slice(enter.length), new Set(), escapes);
+
+  let exit: Parse.Inst[] = [];
+  for (let name of escapes) {
+    let v = getVar(symbols, scope, name, null);
+    if (v == null) continue;
+    let type = v.type.tag == 'link' ? v.type.val : v.type;
+    if (type.tag == 'ptr') {
+      logError(position, `${name} can not be changed in an arena block, a pointer can not be realloc'd out of it`);
+      exitScope(scope);
+      return null;
+    }
+    if (containsFrozen(type, new Set())) {
+      logError(position, `${name} can not be changed in an arena block, a frozen value can not be realloc'd out of it`);
+      exitScope(scope);
+      return null;
+    }
+    if (type.tag != 'struct' || isBasic(type)) continue;
+    exit.push({ tag: 'expr', val: fnCall('realloc', [varExpr(name), varExpr('__arenaParent')]), position });
+  }
+  exit.push({ tag: 'expr', val: fnCall('leaveArena', [varExpr('__arenaParent'), varExpr('__arenaMark')]), position });
+  exit.push({ tag: 'assign', val: { op: '=', to: { tag: 'var', val: 'bp' }, expr: varExpr('__arenaParent') }, position });
+
+  let exitInsts = analyzeInsts(symbols, exit, scope);
+  exitScope(scope);
+  if (exitInsts == null) return null;
+  let inner: Inst = { tag: 'arena', val: body.slice(enter.length), position };
+  return { tag: 'arena', val: [...body.slice(0, enter.length), inner, ...exitInsts], position };
+}
+
+// a frozen value has to stay in the arena std/core freeze built it in, an
+// arena block would realloc it out to the enclosing arena when it escapes.
+// the escape check catches one made by a helper fn, this catches a direct
+// call before the value is ever stored
+function containsFrozen(type: Type, seen: Set<string>): boolean {
+  if (type.tag != 'struct' || isBasic(type)) return false;
+  if (type.val.template.name == 'Frozen' && type.val.template.unit == 'std/core') return true;
+  let name = toStr(type);
+  if (seen.has(name)) return false;
+  seen.add(name);
+  for (let generic of type.val.generics) {
+    if (containsFrozen(generic, seen)) return true;
+  }
+  return getFields(type).some(field => containsFrozen(field.type, seen));
+}
+
+function checkFreeze(scope: FnContext, expr: Expr, position: Position): boolean {
+  if (expr.tag != 'fn_call') return true;
+  for (let arg of expr.val.exprs) {
+    if (!checkFreeze(scope, arg, position)) return false;
+  }
+
+  let fn = expr.val.fn;
+  if (fn.tag != 'fn' || fn.unit != 'std/core' || fn.name != 'freeze') return true;
+  if (scope.inArena) {
+    logError(position, 'can not freeze inside an arena block');
+    return false;
+  }
+  return true;
+}
+
 /*
 function canMutate(
   symbols: UnitSymbols,
@@ -821,16 +1262,21 @@ function ensureLeftExprValid(
     let index = ensureExprValid(symbols, parseIndex, null, scope, position);
     if (index == null) return null;
 
+    if (leftExpr.val.unchecked && (!typeApplicable(index.type, INT, false) || !hasUncheckedIndex(left.type))) {
+      if (position != null) logError(position, '@unchecked needs an int index in to a pointer, vec, Arr, seg, str or Fmt');
+      return null;
+    }
+
 
     if (left.type.tag == 'ptr') {
-      computedExpr = { tag: 'index', val: { var: left, index, const: left.type.const, verifyFn: null, verifyFnType: null, implReturnsPointer: false }, type: left.type.val };
+      computedExpr = { tag: 'index', val: { var: left, index, const: left.type.const, verifyFn: null, verifyFnType: null, implReturnsPointer: false, unchecked: leftExpr.val.unchecked }, type: left.type.val };
     }
     else if (left.type.tag == 'struct' 
       && left.type.val.template.name == 'vec'
       && left.type.val.template.unit == 'std/core'
       && typeApplicable(index.type, INT, false)
     ) {
-      computedExpr = { tag: 'index', val: { var: left, index, const: false, verifyFn: null, verifyFnType: null, implReturnsPointer: false }, type: left.type.val.generics[0] };
+      computedExpr = { tag: 'index', val: { var: left, index, const: false, verifyFn: null, verifyFnType: null, implReturnsPointer: false, unchecked: leftExpr.val.unchecked }, type: left.type.val.generics[0] };
     }
     else {
       let trait = resolveImpl(symbols, 'index', [refType(left.type), index.type], null, position);
@@ -838,11 +1284,11 @@ function ensureLeftExprValid(
 
       let retType = trait.resolvedType.returnType;
       if (retType.tag != 'ptr') {
-        computedExpr = { tag: 'index', val: { var: left, index, const: true, verifyFn: null, verifyFnType: null, implReturnsPointer: false }, type: retType };
+        computedExpr = { tag: 'index', val: { var: left, index, const: true, verifyFn: null, verifyFnType: null, implReturnsPointer: false, unchecked: leftExpr.val.unchecked }, type: retType };
       }
       else {
         let varConst = left.tag == 'left_expr' && isConst(symbols, left.val, scope);
-        computedExpr = { tag: 'index', val: { var: left, index, const: retType.const || varConst, verifyFn: null, verifyFnType: null, implReturnsPointer: true }, type: retType.val };
+        computedExpr = { tag: 'index', val: { var: left, index, const: retType.const || varConst, verifyFn: null, verifyFnType: null, implReturnsPointer: true, unchecked: leftExpr.val.unchecked }, type: retType.val };
       }
     }
   }
@@ -1843,6 +2289,7 @@ interface FnContext {
   genericConsts: Set<string>,
   returnType: Type
   inLoop: boolean
+  inArena: boolean
   variantScope: Enum.VariantScope 
 };
 
@@ -1854,6 +2301,7 @@ function newScope(returnType: Type, generics: Set<string>, genericConsts: Set<st
     genericConsts,
     returnType: returnType,
     inLoop: false,
+    inArena: false
   };
 }
 
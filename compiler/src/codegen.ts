@@ -5,7 +5,7 @@ import { Inst, LeftExpr, Expr, StructInitField, FnCall, Fn, FnImpl, GlobalImpl }
 import { Program } from './replaceGenerics';
 
 export {
-  codegen, OutputFile
+  codegen, OutputFile, FnInstance
 }
 
 interface FnContext {
@@ -31,33 +31,142 @@ interface OutputFile {
   data: string
 }
 
-// generates the c output for the given program
-function codegen(prog: Program, progIncludes: Set<string>): OutputFile[] {
+// the size of the c emitted for one instance of a fn. template names the fn
+// it was made from with its declared types, so overloads stay apart
+interface FnInstance {
+  template: string
+  bytes: number
+}
+
+// units with more fns than this are spread over several files so clang can
+// compile them in parallel
+const FNS_PER_FILE = 64;
+const MAX_FILES_PER_UNIT = 16;
+
+// with callstack every call records its line in a thread local stack that
+// panics print. without it nothing is tracked at runtime, #line directives
+// map the c back to the chad source and the stack is only walked on panic
+let callstackMode = false;
+
+const CALLSTACK_PANIC = `
+void chad_panic(const char* file, int64_t line, const char* message) {
+  fprintf(stderr, "%s in '%s.chad' line %ld\\n", message, file, line);
+  int top = frameIndex;
+  if (top > CHAD_MAX_FRAMES) {
+    fprintf(stderr, "... %d frames too deep to record\\n", top - CHAD_MAX_FRAMES);
+    top = CHAD_MAX_FRAMES;
+  }
+  for (int i = top - 1; i > 0; i--) {
+    fprintf(stderr, "in '%s.chad' line %ld\\n", frames[i].file, frames[i].line);
+  }
+  exit(-1);
+}`;
+
+// return addresses are turned in to lines by addr2line from the line tables
+// the build emits with -gline-tables-only, so a missing addr2line only costs
+// the trace and not the panic message. paths are printed relative to the
+// directory clang ran in, which is where the #line paths are relative to
+function backtracePanic(buildDir: string): string {
+  return `
+#include <execinfo.h>
+#include <unistd.h>
+static void chad_backtrace(const char* file, int64_t line) {
+  void* addrs[64];
+  int count = backtrace(addrs, 64);
+  char** symbols = backtrace_symbols(addrs, count);
+  if (symbols == NULL) return;
+
+  // resolved here, in addr2line's shell /proc/self/exe would be the shell
+  char exe[1024];
+  ssize_t exeLen = readlink("/proc/self/exe", exe, sizeof exe - 1);
+  if (exeLen <= 0) { free(symbols); return; }
+  exe[exeLen] = 0;
+
+  char command[4096];
+  int len = snprintf(command, sizeof command, "addr2line -i -e '%s'", exe);
+  for (int i = 1; i < count && len < (int)sizeof command - 32; i++) {
+    // frames in the executable print as exe(+0x1189) [0x55..] when it is
+    // position independent and exe() [0x401136] otherwise
+    char* open = strchr(symbols[i], '(');
+    char* bracket = strchr(symbols[i], '[');
+    if (open == NULL || bracket == NULL || strstr(symbols[i], ".so") != NULL) continue;
+    unsigned long long addr;
+    if (sscanf(open, "(+%llx)", &addr) != 1 && sscanf(bracket, "[%llx]", &addr) != 1) continue;
+    len += snprintf(command + len, sizeof command - len, " %llx", addr - 1);
+  }
+  free(symbols);
+
+  FILE* out = popen(command, "r");
+  if (out == NULL) return;
+  const char* root = "${buildDir}/";
+  size_t rootLen = strlen(root);
+  char entry[1024];
+  bool first = true;
+  while (fgets(entry, sizeof entry, out) != NULL) {
+    char* colon = strrchr(entry, ':');
+    if (colon == NULL) continue;
+    *colon = 0;
+    long entryLine = strtol(colon + 1, NULL, 10);
+    size_t entryLen = strlen(entry);
+    if (entryLen < 5 || strcmp(entry + entryLen - 5, ".chad") != 0) continue;
+
+    char* path = strstr(entry, root);
+    path = path == NULL ? entry : path + rootLen;
+    bool samePlace = entryLine == line && strncmp(path, file, strlen(file)) == 0;
+    if (!(first && samePlace)) fprintf(stderr, "in '%s' line %ld\\n", path, entryLine);
+    first = false;
+  }
+  pclose(out);
+}
+
+void chad_panic(const char* file, int64_t line, const char* message) {
+  fprintf(stderr, "%s in '%s.chad' line %ld\\n", message, file, line);
+  fflush(stderr);
+  chad_backtrace(file, line);
+  exit(-1);
+}`;
+}
+
+// generates the c output for the given program. with split, each unit gets
+// its own files and all instances of a generic fn land in the same one, so
+// editing one unit leaves the output of the others unchanged. rootPath is
+// the project root relative to where the c files are written
+function codegen(
+  prog: Program,
+  progIncludes: Set<string>,
+  split: boolean,
+  rootPath: string,
+  callstack: boolean,
+  instances: FnInstance[] = []
+): OutputFile[] {
+  callstackMode = callstack;
   let chadDotH = '';
   let chadDotC = '';
+  let prelude = '';
   for (let include of includes) {
     chadDotH += '\n#include <' + include + '>';
   }
 
   for (let include of progIncludes) {
     if (include.startsWith('include/')) {
-      chadDotC += `\n#include <${include.replace('include/', '')}>`;
+      prelude += `\n#include <${include.replace('include/', '')}>`;
+    }
+    else {
+      prelude += `\n#include "${rootPath}/${include}"`;
     }
-
-    chadDotC += '\n#include "../' + include + '"';
   }
 
-  chadDotC += '\n#include "chad.h"';
-  chadDotC += '\ndouble fabs(double); float fabsf(float);';
+  prelude += '\n#include "chad.h"';
+  prelude += '\ndouble fabs(double); float fabsf(float);';
 
-  chadDotC += '\n__thread struct StackFrame { const char* file; int64_t line; } frames[1024]; __thread int frameIndex = 0; __thread uint64_t lastLine; __thread const char* lastFile;';
-  chadDotC += '\nvoid chad_callstack_push() { frames[frameIndex] = (struct StackFrame){ .file = lastFile, .line = lastLine }; frameIndex += 1; }';
-  chadDotC += '\nvoid chad_callstack_pop() { frameIndex -= 1; }';
-
-  chadDotC += '\nvoid chad_panic(const char* file, int64_t line, const char* message) {'
-  chadDotC += '\nfprintf(stderr, "%s in \'%s.chad\' line %ld\\n", message, file, line); for (int i = frameIndex - 1; i > 0; i--) {'
-  chadDotC += 'fprintf(stderr, "in \'%s.chad\' line %ld\\n", frames[i].file, frames[i].line); } exit(-1); }'
+  chadDotH += '\nextern __thread uint64_t lastLine; extern __thread const char* lastFile;';
+  chadDotH += '\nvoid chad_callstack_push(); void chad_callstack_pop(); void chad_panic(const char* file, int64_t line, const char* message);';
 
+  chadDotC += `\n#define CHAD_MAX_FRAMES 1024`;
+  chadDotC += '\n__thread struct StackFrame { const char* file; int64_t line; } frames[CHAD_MAX_FRAMES]; __thread int frameIndex = 0; __thread uint64_t lastLine; __thread const char* lastFile;';
+  chadDotC += '\nvoid chad_callstack_push() { if (frameIndex < CHAD_MAX_FRAMES) frames[frameIndex] = (struct StackFrame){ .file = lastFile, .line = lastLine }; frameIndex += 1; }';
+  chadDotC += '\nvoid chad_callstack_pop() { frameIndex -= 1; }';
+  chadDotC += callstack ? CALLSTACK_PANIC : backtracePanic(process.cwd());
 
   // forward declare all structs for pointers
   for (let type of prog.orderedTypes) {
@@ -85,15 +194,44 @@ function codegen(prog: Program, progIncludes: Set<string>): OutputFile[] {
   }
 
   for (let global of prog.globals) {
+    chadDotH += '\nextern' + codeGenGlobalDecl(global) + ';';
     chadDotC += codeGenGlobal(global) + ';';
   }
 
+  // prototypes are kept out of chad.h and given to each file for only the
+  // fns it calls, so adding a fn does not change every file
+  let prototypes: Map<string, string> = new Map();
+  for (let fn of prog.fns) {
+    let header = fn.header;
+    prototypes.set(getFnUniqueId(header.unit, header.name, header.mode, header.paramTypes, header.returnType), codeGenFnHeader(header) + ';');
+  }
+
+  let unitFnCounts: Map<string, number> = new Map();
   for (let fn of prog.fns) {
-    chadDotH += codeGenFnHeader(fn.header) + ';';
+    unitFnCounts.set(fn.header.unit, (unitFnCounts.get(fn.header.unit) ?? 0) + 1);
   }
 
+  let groups: Map<string, { id: string, code: string }[]> = new Map();
   for (let fn of prog.fns) {
-    chadDotC += codeGenFn(fn);
+    let fileName = 'chad.c';
+    if (split) {
+      let fileCount = 1;
+      while (fileCount * FNS_PER_FILE < unitFnCounts.get(fn.header.unit)! && fileCount < MAX_FILES_PER_UNIT) {
+        fileCount *= 2;
+      }
+      let bucket = nameHash(fn.header.name) % fileCount;
+      fileName = `chad_${normalizeUnitName(fn.header.unit)}_${bucket}.c`;
+    }
+
+    if (!groups.has(fileName)) groups.set(fileName, []);
+    let header = fn.header;
+    let id = getFnUniqueId(header.unit, header.name, header.mode, header.paramTypes, header.returnType);
+    let code = codeGenFn(fn);
+    groups.get(fileName)!.push({ id, code });
+    let template = prog.templates.get(fn)?.header ?? header;
+    let params = template.paramTypes.map(t => toStr(t)).join(', ');
+    let name = `${template.unit}.chad ${template.name}(${params}) ${toStr(template.returnType)}`;
+    instances.push({ template: name, bytes: code.length });
   }
 
   let entry = prog.entry.header;
@@ -146,10 +284,34 @@ function codegen(prog: Program, progIncludes: Set<string>): OutputFile[] {
     return [];
   }
 
-  return [
-    { name: 'chad.h', data: chadDotH },
-    { name: 'chad.c', data: chadDotC },
-  ];
+  // sorted so the order monomorphization happened to find instances in does
+  // not change a file's contents
+  let bodies: Map<string, string> = new Map([['chad.c', chadDotC]]);
+  for (let [fileName, fns] of groups) {
+    fns.sort((a, b) => a.id < b.id ? -1 : a.id > b.id ? 1 : 0);
+    let body = fns.map(fn => fn.code).join('');
+    bodies.set(fileName, fileName == 'chad.c' ? body + chadDotC : body);
+  }
+
+  let outputFiles: OutputFile[] = [{ name: 'chad.h', data: chadDotH }];
+  for (let [fileName, body] of bodies) {
+    let used = '';
+    let names = new Set(body.match(/[A-Za-z_][A-Za-z0-9_]*/g) ?? []);
+    for (let [id, prototype] of prototypes) {
+      if (names.has(id)) used += prototype;
+    }
+    outputFiles.push({ name: fileName, data: prelude + used + body });
+  }
+
+  return outputFiles;
+}
+
+function nameHash(name: string): number {
+  let hash = 5381;
+  for (let i = 0; i < name.length; i++) {
+    hash = ((hash * 33) ^ name.charCodeAt(i)) >>> 0;
+  }
+  return hash;
 }
 
 function codeGenGlobal(global: GlobalImpl): string {
@@ -166,6 +328,10 @@ function codeGenGlobal(global: GlobalImpl): string {
     logError(global.position, 'expression must be compile time');
   }
 
+  return `\n${codeGenGlobalDecl(global)} = ${expr.output}`;
+}
+
+function codeGenGlobalDecl(global: GlobalImpl): string {
   let mode = ''; 
   if (global.header.mode == 'const') {
     mode = 'const';
@@ -175,7 +341,7 @@ function codeGenGlobal(global: GlobalImpl): string {
   }
 
   let name = getGlobalUniqueId(global.header.unit, global.header.name)
-  return `\n${mode} ${codeGenType(global.header.type)} ${name} = ${expr.output}`;
+  return ` ${mode} ${codeGenType(global.header.type)} ${name}`;
 }
 
 function codeGenFn(fn: FnImpl) {
@@ -183,7 +349,7 @@ function codeGenFn(fn: FnImpl) {
   let fnCode = codeGenFnHeader(fn.header) + ' {\n';
   let bodyStr = '\n';
 
-  bodyStr += '\tchad_callstack_push();';
+  if (callstackMode) bodyStr += '\tchad_callstack_push();';
   for (let i = 0; i < fn.body.length; i++) {
     bodyStr += codeGenInst(fn.body, i, 1, ctx);
   }
@@ -194,10 +360,10 @@ function codeGenFn(fn: FnImpl) {
 
   let retType = fn.header.returnType;
   if (retType.tag == 'struct' && retType.val.template.name == 'nil') {
-    bodyStr += '\n\tchad_callstack_pop(); return;'
+    bodyStr += `\n\t${callstackPop()}return;`
   }
   else if (typeApplicable(NIL, retType, false)) {
-    bodyStr += `\n\tchad_callstack_pop(); return (${codeGenType(fn.header.returnType)}){ 0 };`
+    bodyStr += `\n\t${callstackPop()}return (${codeGenType(fn.header.returnType)}){ 0 };`
   }
 
   if (fn.header.returnType.tag == 'struct' 
@@ -402,6 +568,9 @@ function codeGenInst(insts: Inst[], instIndex: number, indent: number, ctx: FnCo
     }
     ctx.deferStack.push(bodyStr + '}');
   }
+  else if (inst.tag == 'arena') {
+    statements.push(codeGenBody(inst.val, indent + 1, true, ctx));
+  }
   else if (inst.tag == 'if') {
     let condition = codeGenExpr(inst.val.cond, ctx, inst.position);
     statements.push(...condition.statements);
@@ -444,12 +613,12 @@ function codeGenInst(insts: Inst[], instIndex: number, indent: number, ctx: FnCo
   }
   else if (inst.tag == 'return') {
     if (inst.val == null) {
-      statements.push('chad_callstack_pop(); return;');
+      statements.push(`${callstackPop()}return;`);
     }
     else {
       let expr = codeGenExpr(inst.val, ctx, inst.position);
       statements.push(...expr.statements);
-      statements.push(`chad_callstack_pop(); return ${expr.output};`)
+      statements.push(`${callstackPop()}return ${expr.output};`)
     }
   }
   else if (inst.tag == 'include') {
@@ -493,9 +662,9 @@ function codeGenInst(insts: Inst[], instIndex: number, indent: number, ctx: FnCo
     let iterSaved = uniqueVarName(ctx, inst.val.iter.type);
     let saveNextFnStmt = ctx.nextFnStmt;
   
-    ctx.nextFnStmt = `lastLine = ${inst.position.line}; lastFile = "${inst.position.document}"; ${varName} = ${nextFnName}(&${iterSaved});`;
+    ctx.nextFnStmt = `${trackLine(inst.position)}${varName} = ${nextFnName}(&${iterSaved});`;
     statements.push(`${iterSaved} = ${iterExpr.output};`);
-    statements.push(`lastLine = ${inst.position.line}; lastFile = "${inst.position.document}"; ${itemTypeStr} ${varName} = ${nextFnName}(&${iterSaved});`);
+    statements.push(`${trackLine(inst.position)}${itemTypeStr} ${varName} = ${nextFnName}(&${iterSaved});`);
     statements.push(`while (${varName} != 0) {`);
     statements.push(codeGenBody(inst.val.body, indent + 1, false, ctx));
     statements.push(ctx.nextFnStmt);
@@ -510,13 +679,23 @@ function codeGenInst(insts: Inst[], instIndex: number, indent: number, ctx: FnCo
       outputText += ctx.deferStack[i];
     }
   }
+  // every statement gets its own #line as nested bodies emit theirs. the
+  // directive starts a new line since defers open a brace right before it
   for (let i of statements) {
-    outputText += tabs + i + '\n';
+    outputText += `\n#line ${inst.position.line} "${inst.position.document}.chad"\n` + tabs + i + '\n';
   }
 
   return outputText;
 }
 
+function callstackPop(): string {
+  return callstackMode ? 'chad_callstack_pop(); ' : '';
+}
+
+function trackLine(position: Position): string {
+  return callstackMode ? `lastLine = ${position.line}; lastFile = "${position.document}"; ` : '';
+}
+
 function uniqueVarName(ctx: FnContext, type: Type | null): string {
   let name = `__expr_${ctx.reservedVars.length}`;
   ctx.reservedVars.push(type);
@@ -528,6 +707,7 @@ function strLen(expr: string) {
   for (let i = 0; i < expr.length; i++) {
     if (expr[i] == '\\') {
       subCount += 1;
+      i += 1; // the escaped char is part of the same byte
     }
   }
   return expr.length - subCount;
@@ -604,7 +784,7 @@ function codeGenExpr(
       deferStmts += ctx.deferStack[i];
     }
 
-    statements.push(`if (${name}.tag == 1) { chad_callstack_pop(); ${deferStmts} return (${ codeGenType(ctx.returnType) }){ .tag = 1, ._val1 = ${name}._val1 }; }`);
+    statements.push(`if (${name}.tag == 1) { ${callstackPop()}${deferStmts} return (${ codeGenType(ctx.returnType) }){ .tag = 1, ._val1 = ${name}._val1 }; }`);
 
     // because this is a leftExpr, it shouldn't save the value to the stack
     if (expr.type.tag == 'struct' && expr.type.val.template.name == 'nil') {
@@ -850,7 +1030,7 @@ function codeGenFnCall(fnCall: FnCall, ctx: FnContext, position: Position): Code
 
   let leftExpr = codeGenLeftExpr(fnCall.fn, ctx, position, true); 
   let statements: string[] = leftExpr.statements;
-  statements.push(`lastLine = ${position.line}; lastFile = "${position.document}";`);
+  if (callstackMode) statements.push(trackLine(position));
 
   let output = leftExpr.output + '(';
   for (let i = 0; i < fnCall.exprs.length; i++) {
@@ -891,9 +1071,8 @@ function codeGenLeftExpr(leftExpr: LeftExpr, ctx: FnContext, position: Position,
       && leftExpr.val.var.type.val.template.name == 'vec'
       && leftExpr.val.var.type.val.template.unit == 'std/core'
     ) {
-
-      let guard = `if (${innerName.output} < 0 || ${innerName.output} >= ${leftExpr.val.var.type.val.constFields[0]}) chad_panic("${position.document}", ${position.line}, "out of bounds");`;
-      statements.push(guard);
+      let guard = leftExpr.val.unchecked ? '' : `if (${innerName.output} < 0 || ${innerName.output} >= ${leftExpr.val.var.type.val.constFields[0]}) chad_panic("${position.document}", ${position.line}, "out of bounds");`;
+      if (guard != '') statements.push(guard);
       leftExprText = `${leftName.output}.val0[${innerName.output}]`;
     }
     else if (leftExpr.val.implReturnsPointer == false) {
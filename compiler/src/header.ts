@@ -1,4 +1,7 @@
 import fs from 'node:fs';
+import os from 'node:os';
+import path from 'node:path';
+import { createHash } from 'node:crypto';
 import { Type, INT, NIL, CHAR, BOOL, I64, I16, I8, U32, U64, U16, U8,
   F32, F64,
   UnitSymbols, Field, Struct 
@@ -7,7 +10,7 @@ import { execSync } from 'child_process';
 import { compilerError } from './util';
 
 export {
-  HeaderInclude, loadHeaderFile, ExternFn
+  HeaderInclude, loadHeaderFile, ExternFn, headerCacheDir
 }
 
 interface ExternFn {
@@ -51,14 +54,120 @@ interface ASTNode {
   type?: ASTType
 }
 
-function loadHeaderFile(headerName: string): UnitSymbols | null {
-  let fileFullPath = headerName;
-  if (headerName.startsWith('include/')) {
-    fileFullPath = '/usr/' + headerName;
+// what is kept of a header between builds: the top level declarations with
+// only the parts read below, and the defines that are numbers. the full ast
+// dump is hundreds of mb for some headers, this is usually a few hundred kb
+interface HeaderCache {
+  version: number
+  deps: { path: string, mtimeMs: number, size: number }[]
+  decls: ASTNode[]
+  defs: string[]
+}
+
+// bump when the cached shape or what is kept of it changes
+const HEADER_CACHE_VERSION = 1;
+const AST_FLAGS = '-Xclang -ast-dump=json -fsyntax-only';
+const DEF_FLAGS = '-E -dM';
+
+function headerCacheDir(): string {
+  let cacheHome = process.env.XDG_CACHE_HOME ?? path.join(os.homedir(), '.cache');
+  return path.join(cacheHome, 'chadscript', 'headers');
+}
+
+function headerCachePath(fileFullPath: string): string {
+  let key = createHash('sha1')
+    .update(`${HEADER_CACHE_VERSION} ${path.resolve(fileFullPath)} ${AST_FLAGS} ${DEF_FLAGS}`)
+    .digest('hex');
+  return path.join(headerCacheDir(), key + '.json');
+}
+
+// the cached declarations, as long as no file the header includes has been
+// touched since they were written
+function readHeaderCache(fileFullPath: string): HeaderCache | null {
+  let cache: HeaderCache;
+  try {
+    cache = JSON.parse(fs.readFileSync(headerCachePath(fileFullPath), 'utf8'));
+  } catch {
+    return null;
   }
-  
-  let astCommand = 'clang -Xclang -ast-dump=json -fsyntax-only ' + fileFullPath;
-  let defCommand = 'clang -E -dM ' + fileFullPath;
+
+  if (cache.version != HEADER_CACHE_VERSION || !depsUnchanged(cache.deps)) return null;
+  return cache;
+}
+
+function depsUnchanged(deps: HeaderCache['deps']): boolean {
+  for (let dep of deps) {
+    let stats = fs.statSync(dep.path, { throwIfNoEntry: false });
+    if (stats == undefined || stats.mtimeMs != dep.mtimeMs || stats.size != dep.size) return false;
+  }
+  return true;
+}
+
+function writeHeaderCache(fileFullPath: string, cache: HeaderCache) {
+  try {
+    fs.mkdirSync(headerCacheDir(), { recursive: true });
+    // written aside and renamed so a concurrent build never reads half a file
+    let cachePath = headerCachePath(fileFullPath);
+    let tempPath = `${cachePath}.${process.pid}`;
+    fs.writeFileSync(tempPath, JSON.stringify(cache));
+    fs.renameSync(tempPath, cachePath);
+  } catch {}
+}
+
+// every file the header pulls in, as listed by the preprocessor
+function headerDeps(fileFullPath: string): HeaderCache['deps'] | null {
+  let depText: string;
+  try {
+    depText = execSync('clang -M ' + fileFullPath, { encoding: 'utf8', stdio: ['pipe', 'pipe', 'ignore'] });
+  } catch {
+    return null;
+  }
+
+  let paths = depText.replace(/\\\n/g, ' ').split(/\s+/).filter(x => x.length > 0).slice(1);
+  let deps: HeaderCache['deps'] = [];
+  for (let depPath of paths) {
+    let stats = fs.statSync(depPath, { throwIfNoEntry: false });
+    if (stats == undefined) return null;
+    deps.push({ path: path.resolve(depPath), mtimeMs: stats.mtimeMs, size: stats.size });
+  }
+  return deps;
+}
+
+function pruneDecl(node: ASTNode): ASTNode {
+  let pruned: ASTNode = { kind: node.kind };
+  if (node.name != undefined) pruned.name = node.name;
+  if (node.type != undefined) pruned.type = { qualType: node.type.qualType };
+  if (node.inner != undefined && (node.kind == 'EnumDecl' || node.kind == 'RecordDecl')) {
+    pruned.inner = node.inner
+      .filter(child => child.name != undefined)
+      .map(child => child.type == undefined
+        ? { kind: child.kind, name: child.name }
+        : { kind: child.kind, name: child.name, type: { qualType: child.type.qualType } });
+  }
+  return pruned;
+}
+
+const KEPT_DECLS = new Set(['EnumDecl', 'VarDecl', 'FunctionDecl', 'RecordDecl', 'TypedefDecl']);
+
+// headers this process already read, so a long running compiler only stats
+// their deps instead of reading the disk cache again
+let loadedHeaders: Map<string, HeaderCache> = new Map();
+
+function loadHeaderDecls(fileFullPath: string): HeaderCache | null {
+  let loaded = loadedHeaders.get(fileFullPath);
+  if (loaded != undefined && depsUnchanged(loaded.deps)) return loaded;
+
+  let cache = readHeaderCache(fileFullPath);
+  if (cache != null) {
+    loadedHeaders.set(fileFullPath, cache);
+    return cache;
+  }
+
+  // taken before clang runs, so an edit made while it runs is not missed
+  let deps = headerDeps(fileFullPath);
+
+  let astCommand = `clang ${AST_FLAGS} ${fileFullPath}`;
+  let defCommand = `clang ${DEF_FLAGS} ${fileFullPath}`;
   let astJson;
   let defTexts;
   try {
@@ -68,7 +177,35 @@ function loadHeaderFile(headerName: string): UnitSymbols | null {
     return null;
   }
   let ast: ASTNode = JSON.parse(astJson);
-  let defs: string[] = defTexts.split('\n');
+  if (ast.inner == undefined) {
+    return null;
+  }
+
+  cache = {
+    version: HEADER_CACHE_VERSION,
+    deps: deps ?? [],
+    decls: ast.inner.filter(node => KEPT_DECLS.has(node.kind)).map(pruneDecl),
+    defs: defTexts.split('\n').filter(def => parseCExpr(def.split(' ')[2]) != null)
+  };
+  if (deps != null) {
+    writeHeaderCache(fileFullPath, cache);
+    loadedHeaders.set(fileFullPath, cache);
+  }
+  return cache;
+}
+
+function loadHeaderFile(headerName: string): UnitSymbols | null {
+  let fileFullPath = headerName;
+  if (headerName.startsWith('include/')) {
+    fileFullPath = '/usr/' + headerName;
+  }
+
+  let decls = loadHeaderDecls(fileFullPath);
+  if (decls == null) {
+    return null;
+  }
+  let ast: ASTNode = { kind: 'TranslationUnitDecl', inner: decls.decls };
+  let defs: string[] = decls.defs;
 
   let structTypeMap: Map<string, Type> = new Map();
   let symbols: UnitSymbols = {
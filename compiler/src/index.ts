@@ -1,39 +1,79 @@
-import { parseFile, parse, ProgramUnit } from './parse';
-import { analyze } from './analyze';
-import { codegen, OutputFile } from './codegen';
+import { parseFile, parse, readUnitFile, unitFilePath, ProgramUnit } from './parse';
+import { analyze, boundsChecks, FnImpl } from './analyze';
+import { codegen, OutputFile, FnInstance } from './codegen';
 import { replaceGenerics, Program } from './replaceGenerics';
 import { loadUnits, UnitSymbols } from './typeload';
-import { loadHeaderFile } from './header';
+import { loadHeaderFile, headerCacheDir } from './header';
 import path from 'node:path';
-import { execSync } from 'node:child_process'
+import { execSync, exec } from 'node:child_process'
+import { createHash } from 'node:crypto';
+import os from 'node:os';
 import { logError, NULL_POS } from './util';
 import fs from 'node:fs';
 import * as Lsp from './lsp';
+import {
+  BuildStats, newStats, passStart, addPass, addUnitTime, addProgram, addInstances, addObject,
+  setClangTime, printStats, writeStats, groupInstances, formatBytes
+} from './stats';
 
 export {
-  analyzeProgram, getFilesRecur
+  analyzeProgram, loadProgramUnits, getFilesRecur
 }
 
 interface Args {
   libs: string[]
   rename: Map<string, string>,
   entryPoints: string[],
-  mode: 'default' | 'build' | 'lsp',
-  outputName: string
+  mode: 'default' | 'build' | 'lsp' | 'prewarm',
+  outputName: string,
+  optLevel: number,
+  march: string | null,
+  mtune: string | null,
+  lto: boolean,
+  profileGenerate: boolean,
+  profileUse: string | null,
+  callstack: boolean,
+  boundsReport: 'none' | 'program' | 'all',
+  bloatReport: boolean,
+  timePasses: boolean,
+  stats: boolean,
+  statsPath: string | null,
+  watch: boolean
 }
 
+const PROFILE_DIR = 'build/profile';
+
+// parsed units are kept for the life of the process and reused while their
+// text is the same, so in --watch and the lsp an edit reparses one file
+// instead of std and everything else
+let unitCache: Map<string, { text: string, unit: ProgramUnit }> = new Map();
+
 function parseArgs(args: string[]): Args | null {
   let parsedArgs: Args = {
     libs: [],
     rename: new Map(),
     entryPoints: [],
     mode: 'default',
-    outputName: 'build/output'
+    outputName: 'build/output',
+    optLevel: 0,
+    march: null,
+    mtune: null,
+    lto: false,
+    profileGenerate: false,
+    profileUse: null,
+    callstack: false,
+    boundsReport: 'none',
+    bloatReport: false,
+    timePasses: false,
+    stats: false,
+    statsPath: null,
+    watch: false
   }
 
   if (args.length > 0) {
     if (args[0] == 'lsp') parsedArgs.mode = 'lsp';
     else if (args[0] == 'build') parsedArgs.mode = 'build';
+    else if (args[0] == 'prewarm') parsedArgs.mode = 'prewarm';
   }
 
   for (let i = 0; i < args.length; i++) {
@@ -53,6 +93,80 @@ function parseArgs(args: string[]): Args | null {
       continue;
     }
 
+    // --release is -O3 with thinlto, each can still be overridden after it
+    if (arg == '--release') {
+      parsedArgs.optLevel = 3;
+      parsedArgs.lto = true;
+      continue;
+    }
+
+    if (/^-O[0-3]$/.test(arg)) {
+      parsedArgs.optLevel = parseInt(arg.slice(2));
+      continue;
+    }
+
+    if (arg.startsWith('-march=')) {
+      parsedArgs.march = arg.slice('-march='.length);
+      continue;
+    }
+
+    if (arg.startsWith('-mtune=')) {
+      parsedArgs.mtune = arg.slice('-mtune='.length);
+      continue;
+    }
+
+    if (arg == '--lto' || arg == '--no-lto') {
+      parsedArgs.lto = arg == '--lto';
+      continue;
+    }
+
+    // pgo is two builds: --profile-generate, run the program on real input,
+    // then --profile-use which merges the raw profiles it left behind
+    if (arg == '--profile-generate') {
+      parsedArgs.profileGenerate = true;
+      continue;
+    }
+
+    if (arg == '--profile-use' || arg.startsWith('--profile-use=')) {
+      parsedArgs.profileUse = arg.includes('=') ? arg.slice('--profile-use='.length) : PROFILE_DIR;
+      continue;
+    }
+
+    // panics walk the stack only when they happen, --callstack goes back to
+    // recording every call for platforms without execinfo or addr2line
+    if (arg == '--callstack') {
+      parsedArgs.callstack = true;
+      continue;
+    }
+
+    if (arg == '--bounds-report' || arg == '--bounds-report=all') {
+      parsedArgs.boundsReport = arg == '--bounds-report' ? 'program' : 'all';
+      continue;
+    }
+
+    if (arg == '--bloat-report') {
+      parsedArgs.bloatReport = true;
+      continue;
+    }
+
+    // --time-passes prints where the build spent its time, --stats writes the
+    // same report as json, next to the output unless a path is given
+    if (arg == '--time-passes') {
+      parsedArgs.timePasses = true;
+      continue;
+    }
+
+    if (arg == '--stats' || arg.startsWith('--stats=')) {
+      parsedArgs.stats = true;
+      parsedArgs.statsPath = arg.includes('=') ? arg.slice('--stats='.length) : null;
+      continue;
+    }
+
+    if (arg == '--watch') {
+      parsedArgs.watch = true;
+      continue;
+    }
+
     if (arg == '-o') {
       if (i == args.length - 1) {
         console.error('exepected name');
@@ -82,7 +196,10 @@ if (args == null) {
   process.exit(-1);
 }
 
-if (args.entryPoints.length == 0) {
+if (args.mode == 'prewarm') {
+  prewarm(args.entryPoints);
+}
+else if (args.entryPoints.length == 0) {
   let result: string;
   try {
     execSync(`node ${__dirname}/index.js -- -o build/build-script build.chad`, { encoding: 'utf-8' });
@@ -91,6 +208,7 @@ if (args.entryPoints.length == 0) {
     process.exit(-1);
   }
 
+  let builds: Args[] = [];
   let lines = result.split('\n');
   for (let line of lines) {
     let scriptArgs = line.split(/\s/);
@@ -104,12 +222,14 @@ if (args.entryPoints.length == 0) {
       }
 
       console.log(outputCommand);
-      let scriptParsedArgs = parseArgs(scriptArgs);
+      // optimization flags given on the command line apply to every build
+      // the script asks for, after the script's own so they win
+      let scriptParsedArgs = parseArgs([...scriptArgs, ...optionArgs(process.argv.slice(2))]);
       if (scriptParsedArgs == null) {
         console.error('invalid command');
         break;
       }
-      build(scriptParsedArgs);
+      builds.push(scriptParsedArgs);
     }
     else if (scriptArgs[0] == 'lsp:' && args.mode == 'lsp') {
       scriptArgs = scriptArgs.slice(1);
@@ -127,34 +247,191 @@ if (args.entryPoints.length == 0) {
       }
     }
   }
+  if (args.watch) watchBuilds(builds);
+  else buildAll(builds);
 }
 else if (args.mode == 'build' || args.mode == 'default') {
-  build(args);
+  if (args.watch) watchBuilds([args]);
+  else buildAll([args]);
 }
 else if (args.mode == 'lsp'){
   Lsp.run(args.entryPoints);
 }
 
-function build(args: Args) {
-  let program = analyzeProgram(args.entryPoints, new Map())
-  if (program != null) {
-    compileProgram(args, program);
+function optionArgs(args: string[]): string[] {
+  return args.filter(arg => arg == '--release' || /^-O[0-3]$/.test(arg)
+    || arg.startsWith('-march=') || arg.startsWith('-mtune=')
+    || arg == '--lto' || arg == '--no-lto'
+    || arg == '--profile-generate' || arg.startsWith('--profile-use')
+    || arg == '--callstack' || arg.startsWith('--bounds-report') || arg == '--bloat-report'
+    || arg == '--time-passes' || arg == '--stats' || arg.startsWith('--stats='));
+}
+
+// fills the header cache for every header the given units use, and the ones
+// std uses when none are given. run once after installing or updating the
+// system headers so the first build does not pay for clang's ast dump
+function prewarm(entryPoints: string[]) {
+  let filePathStack: string[] = [...entryPoints];
+  if (filePathStack.length == 0) {
+    for (let name of fs.readdirSync(path.join(__dirname, 'std'))) {
+      if (name.endsWith('.chad')) filePathStack.push('std/' + name);
+    }
+  }
+
+  let alreadyLoaded: Set<string> = new Set();
+  while (filePathStack.length != 0) {
+    let filePath = filePathStack.pop()!;
+    if (alreadyLoaded.has(filePath)) continue;
+    alreadyLoaded.add(filePath);
+
+    if (filePath.endsWith('.h')) {
+      if (loadHeaderFile(filePath) == null) console.error(`could not load header '${filePath}'`);
+      continue;
+    }
+
+    let progUnit = parseFile(filePath, filePath.slice(0, -5));
+    if (progUnit == null) {
+      console.error(`could not load file '${filePath}'`);
+      continue;
+    }
+    for (let fileName of progUnit.referencedUnits) {
+      if (fileName.endsWith('.h')) filePathStack.push(fileName);
+      else filePathStack.push(fileName + '.chad');
+    }
+  }
+
+  let headerCount = Array.from(alreadyLoaded).filter(x => x.endsWith('.h')).length;
+  console.log(`${headerCount} headers cached in '${headerCacheDir()}'`);
+}
+
+async function buildAll(builds: Args[]) {
+  for (let args of builds) {
+    if (!await build(args, new Set())) process.exit(-1);
   }
-  else {
+}
+
+async function build(args: Args, files: Set<string>): Promise<boolean> {
+  let stats = args.timePasses || args.stats ? newStats(args.outputName) : null;
+  let program = analyzeProgram(args.entryPoints, new Map(), files, stats)
+  if (program == null) {
     console.log('could not finish build');
-    process.exit(-1);
+    return false;
+  }
+  if (args.boundsReport != 'none') printBoundsReport(program.analyzedFns, args.boundsReport == 'all');
+  await compileProgram(args, program, stats);
+
+  if (stats != null && args.timePasses) printStats(stats);
+  if (stats != null && args.stats) writeStats(stats, args.statsPath ?? args.outputName + '.stats.json');
+  return true;
+}
+
+// lists the indexes in each fn that still check their bounds, std is left
+// out unless all is given
+function printBoundsReport(fns: FnImpl[], all: boolean) {
+  let rows: { name: string, checked: number[], unchecked: number }[] = [];
+  for (let fn of fns) {
+    if (!all && fn.header.unit.startsWith('std/')) continue;
+    let counts = boundsChecks(fn);
+    if (counts.checked.length == 0 && counts.unchecked == 0) continue;
+    rows.push({ name: `${fn.header.unit}.chad ${fn.header.name}`, ...counts });
+  }
+
+  rows.sort((a, b) => b.checked.length - a.checked.length || (a.name < b.name ? -1 : 1));
+  let checkedTotal = 0;
+  let uncheckedTotal = 0;
+  for (let row of rows) {
+    let lines = row.checked.length > 0 ? ` on line ${[...new Set(row.checked)].join(', ')}` : '';
+    console.log(`${row.name}: ${row.checked.length} checked${lines}, ${row.unchecked} unchecked`);
+    checkedTotal += row.checked.length;
+    uncheckedTotal += row.unchecked;
   }
+  console.log(`${checkedTotal} bounds checks left, ${uncheckedTotal} removed`);
+}
+
+// lists the fns generics made more than one instance of, by the size of the
+// c they emitted
+function printBloatReport(instances: FnInstance[]) {
+  let groups = groupInstances(instances);
+  for (let group of groups) {
+    if (group.instances < 2) continue;
+    console.log(`${group.name}: ${group.instances} instances, ${formatBytes(group.cBytes)} of c`);
+  }
+
+  let cBytes = groups.reduce((total, group) => total + group.cBytes, 0);
+  console.log(`${instances.length} instances of ${groups.length} fns, ${formatBytes(cBytes)} of c`);
+}
+
+// keeps the process, and with it the parsed units and loaded headers, alive
+// and rebuilds the outputs that read a file when it changes. files are
+// polled rather than watched so editors that save by replacing the file are
+// still seen. build.chad itself is only run once
+function watchBuilds(builds: Args[]) {
+  let buildFiles: Set<string>[] = builds.map(_ => new Set());
+  let watched: Set<string> = new Set();
+  let changed: Set<string> = new Set();
+  let running = false;
+
+  let rebuild = async (all: boolean) => {
+    running = true;
+    let changedNow = changed;
+    changed = new Set();
+    for (let i = 0; i < builds.length; i++) {
+      if (!all && !Array.from(changedNow).some(file => buildFiles[i].has(file))) continue;
+
+      let start = Date.now();
+      let files: Set<string> = new Set();
+      let ok = await build(builds[i], files);
+      // a failed build still reads its files, keep the old set if it got none
+      if (files.size > 0) buildFiles[i] = files;
+      console.log(`${ok ? 'built' : 'failed'} ${builds[i].outputName} in ${Date.now() - start}ms`);
+
+      for (let file of buildFiles[i]) {
+        if (watched.has(file)) continue;
+        watched.add(file);
+        fs.watchFile(file, { interval: 100 }, (curr, prev) => {
+          if (curr.mtimeMs == prev.mtimeMs) return;
+          changed.add(file);
+          if (!running) setTimeout(() => { if (!running && changed.size > 0) rebuild(false) }, 50);
+        });
+      }
+    }
+    running = false;
+    // changes that came in while building
+    if (changed.size > 0) rebuild(false);
+  };
+
+  rebuild(true).then(() => console.log('watching for changes'));
 }
 
 interface AnalysisResult {
   includes: Set<string>,
   program: Program
+  analyzedFns: FnImpl[]
 }
 
-function analyzeProgram(
+function parseCached(filePath: string, unitText: string, fileName: string): ProgramUnit | null {
+  let cached = unitCache.get(filePath);
+  if (cached != undefined && cached.text == unitText) return cached.unit;
+
+  let progUnit = parse(unitText, fileName);
+  if (progUnit != null) unitCache.set(filePath, { text: unitText, unit: progUnit });
+  return progUnit;
+}
+
+interface LoadedUnits {
+  programUnits: ProgramUnit[],
+  headerSymbols: UnitSymbols[],
+  headerFiles: Set<string>
+}
+
+// parses the entry points and every unit and header they use. files is
+// filled with the path of every unit and local header the program reads
+function loadProgramUnits(
   entryPoints: string[],
-  replaceFile: Map<string, string>
-): AnalysisResult | null {
+  replaceFile: Map<string, string>,
+  files: Set<string>,
+  stats: BuildStats | null = null
+): LoadedUnits {
   // determine which files should be analyzed based on entry point
   let alreadyParsed: Set<string> = new Set();
   let filePathStack: string[] = ['std/core.chad', ...entryPoints]
@@ -168,7 +445,10 @@ function analyzeProgram(
     alreadyParsed.add(filePath);
 
     if (filePath.endsWith('.h')) {
+      if (!filePath.startsWith('include/')) files.add(filePath);
+      let start = passStart();
       let headerUnit = loadHeaderFile(filePath);
+      addUnitTime(stats, filePath, 'parse', start);
       if (headerUnit == null) {
         if (!fs.existsSync(filePath)) logError(NULL_POS, `could not load file '${filePath}'. no file`);
         else logError(NULL_POS, `could not load unit '${filePath}'. does it compile?`);
@@ -182,25 +462,18 @@ function analyzeProgram(
     }
     else {
       let fileName = filePath.slice(0, -5);
-      if (replaceFile.has(filePath)) {
-        let progUnit = parse(replaceFile.get(filePath)!, fileName);
-        if (progUnit == null) {
-          logError(NULL_POS, `could not load file '${filePath}'`);
-          programUnits.push(blankUnit(fileName));
-        } 
-        else {
-          programUnits.push(progUnit);
-        }
+      files.add(unitFilePath(filePath));
+      let unitText = replaceFile.has(filePath) ? replaceFile.get(filePath)! : readUnitFile(filePath);
+      let start = passStart();
+      let cached = unitText != null && unitCache.get(filePath)?.text == unitText;
+      let progUnit = unitText == null ? null : parseCached(filePath, unitText, fileName);
+      addUnitTime(stats, fileName, 'parse', start, cached);
+      if (progUnit == null) {
+        logError(NULL_POS, `could not load file '${filePath}'`);
+        programUnits.push(blankUnit(fileName));
       }
       else {
-        let progUnit = parseFile(filePath, fileName);
-        if (progUnit == null) {
-          logError(NULL_POS, `could not load file '${filePath}'`);
-          programUnits.push(blankUnit(fileName));
-        }
-        else {
-          programUnits.push(progUnit);
-        }
+        programUnits.push(progUnit);
       }
 
       for (let fileName of programUnits[programUnits.length - 1].referencedUnits) {
@@ -210,9 +483,28 @@ function analyzeProgram(
     }
   }
 
-  symbols = loadUnits(programUnits, symbols)
+  return { programUnits, headerSymbols: symbols, headerFiles };
+}
+
+// files is filled with the path of every unit and local header the program
+// reads, whether or not analysis succeeds
+function analyzeProgram(
+  entryPoints: string[],
+  replaceFile: Map<string, string>,
+  files: Set<string> = new Set(),
+  stats: BuildStats | null = null
+): AnalysisResult | null {
+  let start = passStart();
+  let { programUnits, headerSymbols, headerFiles } = loadProgramUnits(entryPoints, replaceFile, files, stats);
+  addPass(stats, 'parse', start);
+
+  start = passStart();
+  let symbols = loadUnits(programUnits, headerSymbols);
+  addPass(stats, 'typeload', start);
 
-  let program = analyze(programUnits, symbols);
+  start = passStart();
+  let program = analyze(programUnits, symbols, stats);
+  addPass(stats, 'analyze', start);
   if (program == null) {
     return null;
   } 
@@ -225,44 +517,193 @@ function analyzeProgram(
   if (mainFns.length > 1) {
     logError(NULL_POS, 'only 1 main function should be provided');
   }
-  return { includes: headerFiles, program: replaceGenerics(program, symbols, mainFns[0]) };
+
+  start = passStart();
+  let generic = replaceGenerics(program, symbols, mainFns[0]);
+  addPass(stats, 'generics', start);
+  addProgram(stats, generic);
+  return { includes: headerFiles, program: generic, analyzedFns: program.fns };
+}
+
+interface CompileJob {
+  command: string,
+  objPath: string,
+  key: string,
+  cFile: string
+}
+
+// each output gets its own directory of c files and objects, so building
+// several programs does not throw away each other's cached objects
+function objectDir(outputName: string): string {
+  return path.join('build', 'c', outputName.replace(/[\/.]/g, '_'));
 }
 
-function compileProgram(args: Args, program: AnalysisResult) {
-  let outputFiles: OutputFile[] = codegen(program.program, program.includes);
+async function compileProgram(args: Args, program: AnalysisResult, stats: BuildStats | null) {
+  let objDir = objectDir(args.outputName);
+  fs.mkdirSync(objDir, { recursive: true });
+
+  // without lto, one file keeps every fn visible to clang's inliner
+  let split = args.optLevel == 0 || args.lto;
+  let start = passStart();
+  let instances: FnInstance[] = [];
+  let outputFiles: OutputFile[] = codegen(program.program, program.includes, split, path.relative(objDir, '.'), args.callstack, instances);
+  addPass(stats, 'codegen', start);
+  if (outputFiles.length == 0) return;
+  addInstances(stats, instances);
+  if (args.bloatReport) printBloatReport(instances);
+  if (stats != null) {
+    stats.cFiles = outputFiles.length;
+    stats.cBytes = outputFiles.reduce((total, file) => total + Buffer.byteLength(file.data), 0);
+  }
 
-  let fileNames: string[] = [];
+  // an object is reused when nothing that goes in to it changed: its c file,
+  // chad.h, the local headers it includes and the flags
+  let profile = args.profileUse != null ? mergeProfile(args.profileUse) : null;
+  let flags = optimizationFlags(args, profile);
+  let sharedHash = createHash('sha1').update(flags);
+  for (let include of program.includes) {
+    if (!include.startsWith('include/') && fs.existsSync(include)) sharedHash.update(fs.readFileSync(include));
+  }
+  if (profile != null) sharedHash.update(fs.readFileSync(profile));
   for (let file of outputFiles) {
-    fileNames.push(file.name);
-    fs.writeFileSync(path.join('build', file.name), file.data);
+    if (file.name == 'chad.h') sharedHash.update(file.data);
+  }
+  let sharedKey = sharedHash.digest('hex');
+
+  let cachePath = path.join(objDir, 'cache.json');
+  let cache: { [objPath: string]: string } = {};
+  try {
+    cache = JSON.parse(fs.readFileSync(cachePath, 'utf-8'));
+  } catch {}
+
+  // files left from builds that split the program differently
+  let names = new Set(outputFiles.map(file => file.name));
+  for (let name of fs.readdirSync(objDir)) {
+    let source = name.endsWith('.o') ? name.slice(0, -2) + '.c' : name;
+    if (name != 'cache.json' && !names.has(source)) fs.rmSync(path.join(objDir, name));
   }
 
   // finish by compiling with clang
-  if (fileNames.length == 0) return;
+  start = passStart();
+  let jobs: CompileJob[] = [];
   let objPaths = '';
   let includePath = path.join(__dirname, 'includes');
-  for (let fileName of fileNames) {
-    if (path.extname(fileName) != '.c') {
+  for (let file of outputFiles) {
+    fs.writeFileSync(path.join(objDir, file.name), file.data);
+    if (path.extname(file.name) != '.c') {
       continue;
     }
 
-    let objPath = path.join('build', fileName.slice(0, -2) + '.o');
-    let cSrcPath = path.join('build', fileName);
-    try {
-      execSync(`clang -c -fPIC ${cSrcPath} -o ${objPath} -I${includePath} -Wno-incompatible-pointer-types`);
-    } catch {}
+    let objPath = path.join(objDir, file.name.slice(0, -2) + '.o');
+    let cSrcPath = path.join(objDir, file.name);
+    let key = createHash('sha1').update(sharedKey).update(file.data).digest('hex');
+    addObject(stats, file.name, Buffer.byteLength(file.data));
+    if (cache[objPath] != key || !fs.existsSync(objPath)) {
+      let command = `clang -c -fPIC ${flags} ${cSrcPath} -o ${objPath} -I${includePath} -Wno-incompatible-pointer-types`;
+      jobs.push({ command, objPath, key, cFile: file.name });
+    }
     objPaths += objPath + ' ';
   }
 
+  await compileObjects(jobs, cache, os.cpus().length, stats);
+  fs.writeFileSync(cachePath, JSON.stringify(cache));
+  addPass(stats, 'clang', start);
+
   let libPaths = '';
   for (let i = 0; i < args.libs.length; i++) {
     libPaths += args.libs[i] + ' ';
   }
 
+  // with lto the objects hold bitcode and code generation happens here, so
+  // the link gets the same flags. lld also pulls in bitcode from the libs.
+  // replaceGenerics already shares instances that only differ in a pointer
+  // type, icf folds what is left that still compiles to the same machine
+  // code. safe leaves out fns whose address is taken, so fn pointers stay
+  // distinct
+  let linkFlags = flags;
+  if (args.lto) linkFlags += ' -fuse-ld=lld -Wl,--icf=safe';
+
   let outputPath = args.outputName;
+  start = passStart();
   try {
-    execSync(`clang -lm ${objPaths} ${libPaths} -o ${outputPath} -Wno-parentheses-equality`);
+    execSync(`clang ${linkFlags} -lm ${objPaths} ${libPaths} -o ${outputPath} -Wno-parentheses-equality`);
   } catch {}
+  addPass(stats, 'link', start);
+}
+
+// runs the jobs with at most limit clangs at once. a job that fails is left
+// out of the cache so it is retried by the next build
+function compileObjects(
+  jobs: CompileJob[],
+  cache: { [objPath: string]: string },
+  limit: number,
+  stats: BuildStats | null
+): Promise<void> {
+  let next = 0;
+  let worker = (): Promise<void> => {
+    if (next == jobs.length) return Promise.resolve();
+    let job = jobs[next];
+    next += 1;
+    let start = performance.now();
+    return new Promise(resolve => {
+      exec(job.command, { maxBuffer: 64 * 1024 * 1024 }, (error, stdout, stderr) => {
+        setClangTime(stats, job.cFile, performance.now() - start);
+        process.stderr.write(stderr);
+        if (error == null) cache[job.objPath] = job.key;
+        else delete cache[job.objPath];
+        resolve();
+      });
+    }).then(worker);
+  };
+
+  let workers: Promise<void>[] = [];
+  for (let i = 0; i < Math.min(limit, jobs.length); i++) {
+    workers.push(worker());
+  }
+  return Promise.all(workers).then(() => {});
+}
+
+function optimizationFlags(args: Args, profile: string | null): string {
+  // line tables cost nothing at runtime and are what panics print from
+  let flags = `-O${args.optLevel} -gline-tables-only`;
+  if (args.march != null) flags += ` -march=${args.march}`;
+  if (args.mtune != null) flags += ` -mtune=${args.mtune}`;
+  // each fn in its own section so the linker can fold identical ones
+  if (args.lto) flags += ' -flto=thin -ffunction-sections';
+  if (args.profileGenerate) flags += ` -fprofile-generate=${path.resolve(PROFILE_DIR)}`;
+  if (profile != null) flags += ` -fprofile-use=${profile} -Wno-profile-instr-unprofiled`;
+  return flags;
+}
+
+// turns the .profraw files of a --profile-generate run in to the .profdata
+// clang reads. a path that already is .profdata is used as is
+function mergeProfile(profilePath: string): string | null {
+  if (profilePath.endsWith('.profdata')) return profilePath;
+
+  let rawPaths: string[] = [];
+  if (fs.existsSync(profilePath) && fs.statSync(profilePath).isDirectory()) {
+    for (let name of fs.readdirSync(profilePath)) {
+      if (name.endsWith('.profraw')) rawPaths.push(path.join(profilePath, name));
+    }
+  }
+  else if (fs.existsSync(profilePath)) {
+    rawPaths.push(profilePath);
+  }
+
+  if (rawPaths.length == 0) {
+    console.error(`no profiles found at '${profilePath}', run a --profile-generate build first`);
+    return null;
+  }
+
+  let outputPath = path.join(PROFILE_DIR, 'merged.profdata');
+  fs.mkdirSync(PROFILE_DIR, { recursive: true });
+  try {
+    execSync(`llvm-profdata merge -output=${outputPath} ${rawPaths.join(' ')}`);
+  } catch {
+    console.error('could not merge profiles with llvm-profdata');
+    return null;
+  }
+  return outputPath;
 }
 
 // gets all of the parse units according to the file structure
@@ -12,8 +12,12 @@ import {
 } from 'vscode-languageserver'
 import { createConnection } from 'vscode-languageserver/node'
 import { TextDocument } from 'vscode-languageserver-textdocument'
-import { setLogger as setErrorLogger } from './util';
-import { analyzeProgram } from './index';
+import { setLogger as setErrorLogger, Position } from './util';
+import { loadProgramUnits } from './index';
+import { ProgramUnit } from './parse';
+import { analyzeUnit, Program } from './analyze';
+import { loadUnits, UnitSymbols } from './typeload';
+import { replaceGenerics } from './replaceGenerics';
 import fs from 'fs';
 import url from 'url';
 
@@ -22,6 +26,46 @@ let hasConfigurationCapability = false
 
 let cwd = process.cwd();
 
+// edits closer together than this are checked once
+const DEBOUNCE_MS = 150;
+
+interface LoggedError {
+  position: Position
+  message: string
+}
+
+// the last check of a unit. parses are cached by text, so the same unit
+// object means the same text. the analysis is reused while it is current,
+// which it stops being when the symbols are loaded again
+interface UnitCheck {
+  unit: ProgramUnit
+  parseErrors: LoggedError[]
+  program: Program | null
+  errors: LoggedError[]
+  current: boolean
+}
+
+function captureErrors<T>(f: () => T): { result: T, errors: LoggedError[] } {
+  let errors: LoggedError[] = [];
+  setErrorLogger((position, message, _context) => errors.push({ position, message }));
+  let result = f();
+  return { result, errors };
+}
+
+// everything in a unit but its fn bodies and positions. while this is the
+// same for every unit, the symbols loaded from them are still correct
+function declKey(unit: ProgramUnit): string {
+  return JSON.stringify(unit, (key, value) => {
+    if (key == 'body' || key == 'position') return undefined;
+    if (value instanceof Set) return Array.from(value);
+    return value;
+  });
+}
+
+function yieldToEvents(): Promise<void> {
+  return new Promise(resolve => setImmediate(resolve));
+}
+
 export function run(entryPoints: string[]): void {
   const connection: Connection = createConnection(process.stdin, process.stdout);
 
@@ -54,7 +98,7 @@ export function run(entryPoints: string[]): void {
 
   connection.onDidChangeConfiguration((_change) => {
     for (let document of documents.all()) {
-      validateDocument(document)
+      scheduleCheck(document)
     }
   })
 
@@ -66,19 +110,26 @@ export function run(entryPoints: string[]): void {
 
   documents.onDidClose((_e) => {})
 
-  async function validateDocument(textDocument: TextDocument) {
-    let filePath = decodeURIComponent(textDocument.uri.replace(/^file:\/\//, ''));
-    filePath = filePath.replace(cwd, '').slice(1);
+  let generation = 0;
+  let timer: NodeJS.Timeout | null = null;
+  let symbolsKey = '';
+  let symbols: UnitSymbols[] = [];
+  let loadErrors: LoggedError[] = [];
+  let checks: Map<string, UnitCheck> = new Map();
+  let genericErrors: LoggedError[] = [];
+  let published: Set<string> = new Set();
 
-    /*
-    await connection.sendDiagnostics({ uri: textDocument.uri, diagnostics: [
-      { message: fileUri, range: { start: { line: 0, character: 0 }, end: { line: 0, character: 0 } } },
-      { message: textDocument.uri, range: { start: { line: 1, character: 0 }, end: { line: 0, character: 0 } } }
-    ]})
-    */
+  function toFilePath(uri: string): string {
+    let filePath = decodeURIComponent(uri.replace(/^file:\/\//, ''));
+    return filePath.replace(cwd, '').slice(1);
+  }
 
+  async function publish() {
     let diagnosticMap: Map<string, Diagnostic[]> = new Map();
-    setErrorLogger((position, message, _context) => {
+    let errors = [...loadErrors, ...genericErrors];
+    for (let check of checks.values()) errors.push(...check.parseErrors, ...check.errors);
+    for (let { position, message } of errors) {
+      if (position.document == '') continue;
       if (!diagnosticMap.has(position.document)) {
         diagnosticMap.set(position.document, []);
       }
@@ -90,29 +141,118 @@ export function run(entryPoints: string[]): void {
           end: { line: position.line - 1, character: position.start }
         }
       });
-    });
+    }
 
+    // documents that had errors last time are sent an empty list to clear them
+    for (let fileName of published) {
+      if (!diagnosticMap.has(fileName)) diagnosticMap.set(fileName, []);
+    }
+    published = new Set();
+    for (let [fileName, diagnostics] of diagnosticMap.entries()) {
+      if (diagnostics.length > 0) published.add(fileName);
+      let fileUri = url.pathToFileURL(fileName + '.chad').toString();
+      await connection.sendDiagnostics({ uri: fileUri, diagnostics })
+    }
+  }
+
+  // only units whose text changed are analyzed again, unless a change to
+  // declarations means the symbols are loaded again. then the edited unit
+  // and the units that use it go first and the rest follow. a newer edit
+  // cancels the check between units
+  async function checkProgram(editedPath: string) {
+    let thisGeneration = generation;
+    genericErrors = [];
     let replaceMap: Map<string, string> = new Map();
-    replaceMap.set(filePath, textDocument.getText());
-    let _program = analyzeProgram(entryPoints, replaceMap);
+    for (let document of documents.all()) {
+      replaceMap.set(toFilePath(document.uri), document.getText());
+    }
 
-    let sentToCurrent = false;
-    for (let [fileName, diagnostics] of diagnosticMap.entries()) {
-      if (fileName + '.chad' == filePath) {
-        sentToCurrent = true;
+    let loaded = captureErrors(() => loadProgramUnits(entryPoints, replaceMap, new Set()));
+    let units = loaded.result.programUnits;
+    let unitNames = new Set(units.map(unit => unit.fullName));
+
+    // errors from parsing are only logged when a unit is parsed, not when
+    // its cached parse is reused, so they are kept with the check
+    let nextChecks: Map<string, UnitCheck> = new Map();
+    for (let unit of units) {
+      let old = checks.get(unit.fullName);
+      if (old != undefined && old.unit === unit) {
+        nextChecks.set(unit.fullName, old);
       }
+      else {
+        let parseErrors = loaded.errors.filter(error => error.position.document == unit.fullName);
+        nextChecks.set(unit.fullName, { unit, parseErrors, program: null, errors: old?.errors ?? [], current: false });
+      }
+    }
+    checks = nextChecks;
+    let otherErrors = loaded.errors.filter(error => !unitNames.has(error.position.document));
 
-      let fileUri = url.pathToFileURL(fileName + '.chad').toString();
-      await connection.sendDiagnostics({ uri: fileUri, diagnostics })
+    let key = units.map(declKey).join('\n') + loaded.result.headerSymbols.map(x => x.name).join(',');
+    if (key != symbolsKey || loadErrors.length > 0) {
+      let loadedSymbols = captureErrors(() => loadUnits(units, loaded.result.headerSymbols));
+      symbols = loadedSymbols.result;
+      loadErrors = [...otherErrors, ...loadedSymbols.errors];
+      symbolsKey = key;
+      for (let check of checks.values()) check.current = false;
     }
+    else {
+      loadErrors = otherErrors;
+    }
+
+    let editedUnit = editedPath.slice(0, -'.chad'.length);
+    let rank = (unit: ProgramUnit) => {
+      if (unit.fullName == editedUnit) return 0;
+      if (unit.uses.some(use => use.unitName == editedUnit)) return 1;
+      return 2;
+    };
+    let order: number[] = units.map((_, i) => i);
+    order.sort((a, b) => rank(units[a]) - rank(units[b]));
 
-    if (!sentToCurrent) {
-      await connection.sendDiagnostics({ uri: textDocument.uri, diagnostics: [] })
+    let sentFirst = false;
+    for (let i of order) {
+      let check = checks.get(units[i].fullName)!;
+      if (check.current) continue;
+      if (!sentFirst && rank(check.unit) == 2) {
+        await publish();
+        sentFirst = true;
+      }
+
+      await yieldToEvents();
+      if (thisGeneration != generation) return;
+      let analyzed = captureErrors(() => analyzeUnit(symbols[i], check.unit));
+      check.program = analyzed.result;
+      check.errors = analyzed.errors;
+      check.current = true;
     }
+    await publish();
+
+    // monomorphization finds the errors in generic fns, which needs all of them
+    let program: Program = { fns: [], globals: [] };
+    for (let check of checks.values()) {
+      if (check.program == null) return;
+      program.fns.push(...check.program.fns);
+      program.globals.push(...check.program.globals);
+    }
+    let mainFns = program.fns.filter(x => x.header.name == 'main');
+    if (mainFns.length != 1 || loadErrors.length > 0) return;
+
+    await yieldToEvents();
+    if (thisGeneration != generation) return;
+    genericErrors = captureErrors(() => replaceGenerics(program, symbols, mainFns[0])).errors;
+    if (genericErrors.length > 0) await publish();
+  }
+
+  function scheduleCheck(textDocument: TextDocument) {
+    generation += 1;
+    if (timer != null) clearTimeout(timer);
+    timer = setTimeout(() => {
+      timer = null;
+      checkProgram(toFilePath(textDocument.uri));
+    }, DEBOUNCE_MS);
   }
 
-  documents.onDidChangeContent(async (change) => {
-    await validateDocument(change.document)
+  documents.onDidChangeContent((change) => {
+    scheduleCheck(change.document)
   })
 
   /*
@@ -41,6 +41,7 @@ export {
   SourceLine, ProgramUnit, GenericType, FnType, Type, Fn, Var, Struct, CondBody,
   ForIn, Declare, Assign, FnCall, Inst, DotOp, LeftExpr, Index, StructInitField,
   BinExpr, Expr, parseDir, parseFile, FieldVisibility, FnMode, GlobalMode, parse,
+  readUnitFile, unitFilePath,
   StructMode
 }
 
@@ -192,6 +193,7 @@ type Inst = { tag: 'if', val: CondBody, position: Position }
   | { tag: 'assign', val: Assign, position: Position }
   | { tag: 'include', val: Include, position: Position }
   | { tag: 'defer', val: Inst[], position: Position }
+  | { tag: 'arena', val: Inst[], position: Position }
 
 interface DotOp {
   left: Expr,
@@ -201,6 +203,7 @@ interface DotOp {
 interface Index {
   var: Expr,
   index: Expr
+  unchecked: boolean
 }
 
 type LeftExpr = { tag: 'dot', val: DotOp }
@@ -258,23 +261,34 @@ const MAPPING: [string, number][] = [
   ['+',  8], ['-', 8],
   ['/', 9], ['%', 9], ['*', 9],
 ]; 
+const PRECEDENCE: Map<string, number> = new Map(MAPPING);
 
-function positionRange(tokens: Token[]): Position {
-  if (tokens.length == 0) return { end: 0, start: 0, line: 0, document: '' };
-  return { ...tokens[0].position, end: tokens[tokens.length - 1].position.end, start: tokens[0].position.start };
+function positionRange(tokens: Token[], start: number = 0, end: number = tokens.length): Position {
+  if (end <= start) return { end: 0, start: 0, line: 0, document: '' };
+  return { ...tokens[start].position, end: tokens[end - 1].position.end, start: tokens[start].position.start };
 }
 
-function parseFile(filePath: string, progName: string): ProgramUnit | null {
-  let unitText;
+// std units live next to the compiler, everything else is relative to cwd
+function unitFilePath(filePath: string): string {
   if (filePath.startsWith('std/')) {
-    filePath = __dirname + '/' + filePath;
+    return __dirname + '/' + filePath;
   }
+  return filePath;
+}
 
+function readUnitFile(filePath: string): string | null {
   try {
-    unitText = fs.readFileSync(filePath, 'utf8');
+    return fs.readFileSync(unitFilePath(filePath), 'utf8');
   } catch (err) {
     return null;
   }
+}
+
+function parseFile(filePath: string, progName: string): ProgramUnit | null {
+  let unitText = readUnitFile(filePath);
+  if (unitText == null) {
+    return null;
+  }
   
   return parse(unitText, progName);
 }
@@ -1182,6 +1196,11 @@ function parseInst(line: SourceLine, body: SourceLine[]): Inst | null {
       return { tag: 'defer', val: b, position: line.position }
     }
   }
+  else if (keyword == 'arena' && tokens.length == 1) {
+    let b = parseInstBody(body);
+    if (b == null) return null;
+    return { tag: 'arena', val: b, position: line.position }
+  }
   else if (keyword == 'for') {
     if (tokens.length < 4 || tokens[2].val != 'in') {
       logError(line.position, 'expected for <var> in <iter>');
@@ -1396,7 +1415,23 @@ function tryParseArrExpr(tokens: Token[]): LeftExpr | null {
     return null;
   }
 
-  return { tag: 'index', val: { var: expr, index: innerExpr }};
+  return { tag: 'index', val: { var: expr, index: innerExpr, unchecked: false }};
+}
+
+// @unchecked(x[i]) is an index that skips the bounds check, it can be read
+// and assigned like any other index
+function tryParseUnchecked(tokens: Token[], position: Position): LeftExpr | null {
+  if (tokens.length < 5 || tokens[0].val != '@' || tokens[1].val != 'unchecked'
+    || tokens[tokens.length - 1].val != ')' || getFirstBalanceIndexFromEnd(tokens, '(', ')') != 2) {
+    return null;
+  }
+
+  let inner = tryParseLeftExpr(tokens.slice(3, -1), position);
+  if (inner == null || inner.tag != 'index') {
+    logError(position, 'expected an index in @unchecked');
+    return null;
+  }
+  return { tag: 'index', val: { ...inner.val, unchecked: true } };
 }
 
 function tryParseLeftExpr(tokens: Token[], position: Position): LeftExpr | null {
@@ -1404,6 +1439,11 @@ function tryParseLeftExpr(tokens: Token[], position: Position): LeftExpr | null
     return { tag: 'var', val: tokens[0].val };
   }
 
+  let unchecked = tryParseUnchecked(tokens, position);
+  if (unchecked != null) {
+    return unchecked;
+  }
+
   let dot = tryParseDotOp(tokens);
   if (dot != null) {
     return dot;
@@ -1450,39 +1490,53 @@ function tryParseExpr(tokens: Token[], position: Position): Expr | null {
     }
   }
 
-  // parse all bin expr
-  for (let i = 0; i < MAPPING.length; i++) {
-    for (let props of MAPPING) {
-      if (props[1] != i) {
-        continue;
-      }
-
-      let splits = balancedSplitTwoBackwards(tokens, props[0]);
-      if (props[0] == ':' && splits.length == 1) {
-        if (splits[0][0].val == ':') {
-          if (splits[0].length == 1) {
-            return { tag: 'range', left: null, right: null, position };
-          }
-          let right = tryParseExpr(tokens.slice(1), position);
-          if (right == null) return null;
-          return { tag: 'range', left: null, right, position };
-        }
-        if (splits[0][splits[0].length - 1].val == ':') {
-          let left = tryParseExpr(tokens.slice(0, -1), position);
-          if (left == null) return null;
-          return { tag: 'range', left, right: null, position };
-        }
-      }
-
-      if (splits.length != 2) continue;
+  // find the operators outside of brackets in one pass. an operator at the
+  // start, at the end or right after another operator is a prefix of the operand
+  let ops: number[] = [];
+  let lastRange = -1;
+  let depth = 0;
+  for (let i = 0; i < tokens.length; i++) {
+    let val = tokens[i].val;
+    if (val == '(' || val == '[' || val == '{') {
+      depth += 1;
+    } else if (val == ')' || val == ']' || val == '}') {
+      depth -= 1;
+    }
+    if (depth != 0) {
+      continue;
+    }
 
-      let binOp = tryParseBinOp(splits[0], splits[1], props[0], position);
-      if (binOp == null) {
-        return null;
-      }
+    // try and assert take the rest of the expression as their operand
+    if (i != 0 && (val == 'try' || val == 'assert')) {
+      break;
+    }
+    if (val == ':') {
+      lastRange = i;
+    }
+    if (i != 0 && i != tokens.length - 1 && PRECEDENCE.has(val) && ops[ops.length - 1] != i - 1) {
+      ops.push(i);
+    }
+  }
 
-      return binOp;
+  // open ranges
+  if (lastRange == 0) {
+    if (tokens.length == 1) {
+      return { tag: 'range', left: null, right: null, position };
     }
+    let right = tryParseExpr(tokens.slice(1), position);
+    if (right == null) return null;
+    return { tag: 'range', left: null, right, position };
+  }
+  if (lastRange == tokens.length - 1) {
+    let left = tryParseExpr(tokens.slice(0, -1), position);
+    if (left == null) return null;
+    return { tag: 'range', left, right: null, position };
+  }
+
+  if (ops.length > 0) {
+    let order: BinOrder = { ops, next: 0 };
+    let tree = orderBinOps(tokens, order, 0, 0);
+    return buildBinOps(tokens, tree, position);
   }
 
   if (tokens.length >= 2 && tokens[0].val == '(' && tokens[tokens.length - 1].val == ')') {
@@ -1504,6 +1558,11 @@ function tryParseExpr(tokens: Token[], position: Position): Expr | null {
     }
   }
 
+  let unchecked = tryParseUnchecked(tokens, position);
+  if (unchecked != null) {
+    return { tag: 'left_expr', val: unchecked, position };
+  }
+
   let macroCall = tryParseMacroCall(tokens);
   if (macroCall != null) {
     return { tag: 'macro_call', val: macroCall, position };
@@ -1582,6 +1641,82 @@ function tryParseExpr(tokens: Token[], position: Position): Expr | null {
   return null;
 }
 
+type BinTree = { tag: 'operand', start: number, end: number }
+  | { tag: 'op', index: number, left: BinTree, right: BinTree, start: number, end: number }
+
+interface BinOrder {
+  ops: number[]
+  next: number
+}
+
+// precedence climbing over the operator indices found by tryParseExpr.
+// operators of the same precedence group to the left
+function orderBinOps(tokens: Token[], order: BinOrder, start: number, minPrec: number): BinTree {
+  let end = order.next < order.ops.length ? order.ops[order.next] : tokens.length;
+  let tree: BinTree = { tag: 'operand', start, end };
+
+  while (order.next < order.ops.length) {
+    let index = order.ops[order.next];
+    let prec = PRECEDENCE.get(tokens[index].val)!;
+    if (prec < minPrec) {
+      break;
+    }
+    order.next += 1;
+
+    let right: BinTree;
+    if (tokens[index].val == 'is') {
+      // the right side is a type, it ends at the next operator
+      let rightEnd = order.next < order.ops.length ? order.ops[order.next] : tokens.length;
+      right = { tag: 'operand', start: index + 1, end: rightEnd };
+    } else {
+      right = orderBinOps(tokens, order, index + 1, prec + 1);
+    }
+    tree = { tag: 'op', index, left: tree, right, start, end: right.end };
+  }
+
+  return tree;
+}
+
+function buildBinOps(tokens: Token[], tree: BinTree, position: Position): Expr | null {
+  if (tree.tag == 'operand') {
+    return tryParseExpr(tokens.slice(tree.start, tree.end), position);
+  }
+
+  let op = tokens[tree.index].val;
+  if (op == 'is') {
+    let leftTokens = tokens.slice(tree.start, tree.index);
+    let left = tryParseLeftExpr(leftTokens, positionRange(leftTokens));
+    if (left == null) {
+      return null;
+    }
+    let right = tryParseType(tokens.slice(tree.index + 1, tree.end));
+    if (right == null) {
+      return null;
+    }
+    return { tag: 'is', val: left, right, position };
+  }
+
+  if (op == ':') {
+    let left = buildBinOps(tokens, tree.left, position);
+    if (left == null) return null;
+    let right = buildBinOps(tokens, tree.right, position);
+    if (right == null) return null;
+    return { tag: 'range', left, right, position };
+  }
+
+  let left = buildBinOps(tokens, tree.left, positionRange(tokens, tree.start, tree.index));
+  if (left == null) {
+    return null;
+  }
+
+  let right = buildBinOps(tokens, tree.right, positionRange(tokens, tree.index + 1, tree.end));
+  if (right == null) {
+    return null;
+  }
+
+  return { tag: 'bin', val: { op, left, right }, position };
+}
+
 function tryParseFmtString(lineExpr: string, position: Position): Expr[] | null {
   let exprs: Expr[] = [];
   let constStrStart = 0;
@@ -1622,48 +1757,6 @@ function tryParseFmtString(lineExpr: string, position: Position): Expr[] | null
   return exprs;
 }
 
-function tryParseBinOp(leftTokens: Token[], rightTokens: Token[], op: string, position: Position): Expr | null {
-  if (op == 'is') {
-    let left = tryParseLeftExpr(leftTokens, positionRange(leftTokens));
-    if (left == null) {
-      return null;
-    }
-    let right = tryParseType(rightTokens);
-    if (right == null) {
-      return null;
-    }
-    return { tag: 'is', val: left, right, position };
-  }
-
-  if (op == ':') {
-    let right: Expr | null = null;
-    let left: Expr | null = null;
-    if (leftTokens.length != 0) {
-      left = tryParseExpr(leftTokens, position);
-      if (left == null) return null;
-    }
-
-    if (rightTokens.length != 0) {
-      right = tryParseExpr(rightTokens, position);
-      if (right == null) return null;
-    }
-
-    return { tag: 'range', left, right, position }
-  }
-
-  let left = tryParseExpr(leftTokens, positionRange(leftTokens));
-  if (left == null) {
-    return null;
-  }
-
-  let right = tryParseExpr(rightTokens, positionRange(rightTokens));
-  if (right == null) {
-    return null;
-  }
-
-  return { tag: 'bin', val: { op, left, right }, position};
-}
-
 function parseIncludeLine(
   line: string,
   position: Position,
@@ -1708,17 +1801,49 @@ function parseIncludeLine(
   return outLine;
 }
 
+// characters that end the current token, by char code
+const SPLIT_CHARS: boolean[] = [];
+for (let c of ' +=.,()[]{}&*!?@:^|;') {
+  SPLIT_CHARS[c.charCodeAt(0)] = true;
+}
+
+// pushes the token, joining it with the tokens before it if together
+// they are one operator
+function pushToken(tokens: Token[], val: string, position: Position) {
+  let last = tokens.length - 1;
+  let prev = last >= 0 ? tokens[last].val : '';
+  if (val == ':' && prev == ':') {
+    tokens[last].val = '::';
+    return;
+  }
+  if (val == '=') {
+    if (prev == '+' && last >= 1 && tokens[last - 1].val == '+') {
+      tokens.pop();
+      tokens[last - 1].val = '++=';
+      return;
+    }
+    if (prev == '!' || prev == '>' || prev == '<' || prev == '+' || prev == '-' || prev == '=') {
+      tokens[last].val = prev + '=';
+      return;
+    }
+  }
+  if ((val == '>' && prev == '=') || (val == '&' && prev == '&') || (val == '|' && prev == '|')) {
+    tokens[last].val = prev + val;
+    tokens[last].position.end += 1;
+    return;
+  }
+  tokens.push({ val, position });
+}
+
 function splitTokens(line: string, documentName: string, lineNumber: number): Token[] {
   // split tokens based on special characters
   let tokens: Token[] = [];
   let tokenStart = 0;
-  const splitTokens = [' ', '+', '=', '.', ',', '(', ')', '[', ']', '{', '}', '&', '*', '!', '?', '@', ':', '^', '|', ';'];
   for (let i = 0; i < line.length; i++) {
     // process string as a single token
     if (line[i] == '"') {
-      let possibleSlice = line.slice(tokenStart, i);
-      if (possibleSlice.length != 0) {
-        tokens.push({ val: possibleSlice, position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      if (i > tokenStart) {
+        pushToken(tokens, line.slice(tokenStart, i), { document: documentName, line: lineNumber, start: tokenStart, end: i });
       }
       tokenStart = i + 1;
       i += 1;
@@ -1738,15 +1863,14 @@ function splitTokens(line: string, documentName: string, lineNumber: number): To
         i += 1;
       }
 
-      tokens.push({ val: '"' + line.slice(tokenStart, i) + '"', position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      pushToken(tokens, '"' + line.slice(tokenStart, i) + '"', { document: documentName, line: lineNumber, start: tokenStart, end: i });
       tokenStart = i + 1;
     }
 
     // process chars as a single token
     if (line[i] == '\'' && (line[i - 1] == ' ' || line[i - 1] == '(' || line[i - 1] == '[')) {
-      let possibleSlice = line.slice(tokenStart, i);
-      if (possibleSlice.length != 0) {
-        tokens.push({ val: possibleSlice, position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      if (i > tokenStart) {
+        pushToken(tokens, line.slice(tokenStart, i), { document: documentName, line: lineNumber, start: tokenStart, end: i });
       }
       tokenStart = i + 1;
       i += 1;
@@ -1756,73 +1880,34 @@ function splitTokens(line: string, documentName: string, lineNumber: number): To
         }
         i += 1;
       }
-      tokens.push({ val: '\'' + line.slice(tokenStart, i) + '\'', position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      pushToken(tokens, '\'' + line.slice(tokenStart, i) + '\'', { document: documentName, line: lineNumber, start: tokenStart, end: i });
       tokenStart = i + 1;
     } else if (line[i] == '\''){
-      let possibleSlice = line.slice(tokenStart, i);
-      if (possibleSlice.length != 0) {
-        tokens.push({ val: possibleSlice, position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      if (i > tokenStart) {
+        pushToken(tokens, line.slice(tokenStart, i), { document: documentName, line: lineNumber, start: tokenStart, end: i });
       }
 
-      tokens.push({ val: '\'', position: { document: documentName, line: lineNumber, start: i, end: i + 1 } });
+      pushToken(tokens, '\'', { document: documentName, line: lineNumber, start: i, end: i + 1 });
       tokenStart = i + 1;
     }
 
-    if (splitTokens.includes(line[i])) {
-      let possibleSlice = line.slice(tokenStart, i);
+    if (SPLIT_CHARS[line.charCodeAt(i)]) {
       // protects against double space and spaces trailing other splits
-      if (possibleSlice.length != 0) {
-        tokens.push({ val: possibleSlice, position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+      if (i > tokenStart) {
+        pushToken(tokens, line.slice(tokenStart, i), { document: documentName, line: lineNumber, start: tokenStart, end: i });
       }
       tokenStart = i + 1;
 
       if (line[i] != ' ') {
-        tokens.push({ val: line[i], position: { document: documentName, line: lineNumber, start: tokenStart, end: i } });
+        pushToken(tokens, line[i], { document: documentName, line: lineNumber, start: tokenStart, end: i });
       }
     }
   }
 
   // push the last token if it does not follow a split token
-  if (!splitTokens.includes(line[line.length - 1]) && line[line.length - 1] != '"' && line[line.length - 1] != '\'') {
-    let token = line.slice(tokenStart, line.length);
-    tokens.push({ val: token, position: { document: documentName, line: lineNumber, start: tokenStart, end: line.length } });
-  }
-
-  // combine the tokens that should not have been split
-  for (let i = tokens.length - 1; i >= 1; i--) {
-    if (tokens[i - 1].val == ':' && tokens[i].val == ':') {
-      tokens.splice(i, 1);
-      tokens[i - 1].val = '::';
-    }
-    else if (tokens[i - 1].val == '!' && tokens[i].val == '=') {
-      tokens.splice(i, 1);
-      tokens[i - 1].val = '!=';
-    }
-    else if (i > 1 && tokens[i - 2].val == '+' && tokens[i - 1].val == '+' && tokens[i].val == '=') {
-      tokens.splice(i - 1, 2);
-      tokens[i - 2].val = '++=';
-      i -= 1;
-    }
-    else if (tokens[i].val == '=' && (tokens[i - 1].val == '>' || tokens[i - 1].val == '<'
-      || tokens[i - 1].val == '+' || tokens[i - 1].val == '-' || tokens[i - 1].val == '=')) {
-      tokens[i - 1].val = tokens[i - 1].val + tokens[i].val;
-      tokens.splice(i, 1);
-    }
-    else if (tokens[i - 1].val == '=' && tokens[i].val == '>') {
-      tokens.splice(i, 1);
-      tokens[i - 1].val = '=>';
-      tokens[i - 1].position.end += 1;
-    }
-    else if (tokens[i - 1].val == '&' && tokens[i].val == '&') {
-      tokens.splice(i, 1);
-      tokens[i - 1].val = '&&';
-      tokens[i - 1].position.end += 1;
-    }
-    else if (tokens[i - 1].val == '|' && tokens[i].val == '|') {
-      tokens.splice(i, 1);
-      tokens[i - 1].val = '||';
-      tokens[i - 1].position.end += 1;
-    }
+  let lastChar = line[line.length - 1];
+  if (!SPLIT_CHARS[line.charCodeAt(line.length - 1)] && lastChar != '"' && lastChar != '\'') {
+    pushToken(tokens, line.slice(tokenStart, line.length), { document: documentName, line: lineNumber, start: tokenStart, end: line.length });
   }
 
   return tokens;
@@ -1846,8 +1931,12 @@ function getLines(data: string, documentName: string): SourceLine[] {
   let lines = data.split('\n');
   let sourceLines: SourceLine[] = [];
 
-  // the last line can be merged if the parens are not closed
+  // the last line can be merged if the parens are not closed, the
+  // brackets still open are counted as the tokens are added
   let merge: Token[] = [];
+  let parenOpen = 0;
+  let squareOpen = 0;
+  let curlyOpen = 0;
 
   // used for comment conditions
   let lineSkipSet: Set<number> = new Set();
@@ -1943,8 +2032,29 @@ function getLines(data: string, documentName: string): SourceLine[] {
     }
 
     let tokens: Token[] = splitTokens(line, documentName, lineNumber + 1);
-    merge.push(...tokens)
-    if (!bracketIsOpen(merge)) {
+    for (let token of tokens) {
+      merge.push(token);
+      if (token.val == '(') {
+        parenOpen += 1;
+      }
+      else if (token.val == ')') {
+        parenOpen -= 1;
+      }
+      else if (token.val == '[') {
+        squareOpen += 1;
+      }
+      else if (token.val == ']') {
+        squareOpen -= 1;
+      }
+      else if (token.val == '{') {
+        curlyOpen += 1;
+      }
+      else if (token.val == '}') {
+        curlyOpen -= 1;
+      }
+    }
+
+    if (parenOpen == 0 && squareOpen == 0 && curlyOpen == 0) {
       sourceLines.push({ indent, tokens: merge, position: linePosition });
       merge = [];
     }
@@ -1952,33 +2062,3 @@ function getLines(data: string, documentName: string): SourceLine[] {
 
   return sourceLines;
 }
-
-function bracketIsOpen(tokens: Token[]): boolean {
-  let parenOpen = 0;
-  let squareOpen = 0;
-  let curlyOpen = 0;
-
-  for (let i = 0; i < tokens.length; i++) {
-    if (tokens[i].val == '(') {
-      parenOpen += 1;
-    }
-    else if (tokens[i].val == ')') {
-      parenOpen -= 1;
-    }
-    else if (tokens[i].val == '[') {
-      squareOpen += 1;
-    }
-    else if (tokens[i].val == ']') {
-      squareOpen -= 1;
-    }
-    else if (tokens[i].val == '{') {
-      curlyOpen += 1;
-    }
-    else if (tokens[i].val == '}') {
-      curlyOpen -= 1;
-    }
-  }
-
-  return parenOpen != 0 || squareOpen != 0 || curlyOpen != 0;
-}
-
@@ -1,10 +1,10 @@
 import { FnMode } from './parse';
-import { FnImpl, Inst, Expr, LeftExpr, Program as AnalyzeProgram, GlobalImpl, MacroArg, CondBody } from './analyze';
+import { FnImpl, Inst, Expr, LeftExpr, Program as AnalyzeProgram, GlobalImpl, MacroArg, CondBody, visitInsts } from './analyze';
 import { compilerError, Position, logError } from './util';
 import {
   Type, getTypeKey, applyGenericMap, resolveImpl, BOOL, typeApplicable,
   NIL, typeApplicableStateful, RANGE, isBasic, UnitSymbols, INT, FMT, STR,
-  F64, getFields, isGeneric, toStr, Fn, typeEq, applyConstMap
+  F64, getFields, isGeneric, toStr, Fn, typeEq, applyConstMap, U8
 } from './typeload';
 
 export {
@@ -16,6 +16,8 @@ interface Program {
   globals: GlobalImpl[]
   orderedTypes: Type[]
   entry: FnImpl
+  // the analyzed fn each instance was made from
+  templates: Map<FnImpl, FnImpl>
 }
 
 interface FnKey {
@@ -41,6 +43,12 @@ interface FnSet {
   // maps via json(FnKey)
   fns: Map<string, FnImpl>,
 
+  // instance to the fn it was made from
+  templates: Map<FnImpl, FnImpl>,
+
+  // template to the generics its calls are made with u8 in place of
+  erasable: Map<FnImpl, Set<string>>,
+
   // maps via json(FnKey)
   used: Set<string>
 
@@ -62,6 +70,8 @@ function replaceGenerics(prog: AnalyzeProgram, symbols: UnitSymbols[], mainFn: F
     fnTemplates: new Map(),
     types: new Map(),
     fns: new Map(),
+    templates: new Map(),
+    erasable: new Map(),
     used: new Set(),
     symbols,
     fieldStack: [],
@@ -91,7 +101,8 @@ function replaceGenerics(prog: AnalyzeProgram, symbols: UnitSymbols[], mainFn: F
     orderedTypes,
     fns,
     globals: prog.globals,
-    entry
+    entry,
+    templates: fnSet.templates
   };
 }
 
@@ -138,6 +149,168 @@ function getFnImpl(
   return null;
 }
 
+// the generics of a template that only ever appear as the target of a
+// pointer that is passed along, compared or cast, and never indexed, read
+// through or sized. every instance that differs only in them emits the same
+// c, so calls erase them to u8 and share one instance
+function erasableGenerics(set: FnSet, fn: FnImpl): Set<string> {
+  let cached = set.erasable.get(fn);
+  if (cached != undefined) return cached;
+  // a recursive call sees nothing erasable until this one is done
+  let erasable: Set<string> = new Set();
+  set.erasable.set(fn, erasable);
+
+  let candidates: Set<string> = new Set();
+  let header: Type = { tag: 'fn', paramTypes: fn.header.paramTypes, returnType: fn.header.returnType };
+  collectGenerics(header, candidates);
+
+  let ptrNames: Map<string, Set<string>> = new Map();
+  for (let generic of candidates) ptrNames.set(generic, new Set());
+  for (let i = 0; i < fn.header.paramTypes.length; i++) {
+    for (let generic of candidates) {
+      if (mentionsGeneric(fn.header.paramTypes[i], generic)) ptrNames.get(generic)!.add(fn.header.paramNames[i]);
+    }
+  }
+
+  let rejected: Set<string> = new Set();
+  let checkType = (type: Type | null) => {
+    if (type == null) return;
+    for (let generic of candidates) {
+      if (!onlyBehindPtr(type, generic)) rejected.add(generic);
+    }
+  };
+  let isPtrTo = (type: Type): string | null => {
+    if (type.tag == 'link') type = type.val;
+    return type.tag == 'ptr' && type.val.tag == 'generic' && candidates.has(type.val.val) ? type.val.val : null;
+  };
+
+  for (let type of fn.header.paramTypes) checkType(type);
+  checkType(fn.header.returnType);
+
+  let includeLines: string[] = [];
+  visitInsts(fn.body, {
+    inst: inst => {
+      if (inst.tag == 'declare') {
+        checkType(inst.val.type);
+        for (let generic of candidates) {
+          if (mentionsGeneric(inst.val.type, generic)) ptrNames.get(generic)!.add(inst.val.name);
+        }
+      }
+      else if (inst.tag == 'for_in') checkType(inst.val.nextFnType);
+      else if (inst.tag == 'include') {
+        for (let type of inst.val.types) {
+          for (let generic of candidates) {
+            if (mentionsGeneric(type, generic)) rejected.add(generic);
+          }
+        }
+        includeLines.push(...inst.val.lines);
+      }
+    },
+    expr: expr => {
+      checkType(expr.type);
+      if (expr.tag == 'bin' && expr.val.op != '==' && expr.val.op != '!=') {
+        let generic = isPtrTo(expr.val.left.type) ?? isPtrTo(expr.val.right.type);
+        if (generic != null) rejected.add(generic);
+      }
+      else if (expr.tag == 'macro_call') {
+        for (let arg of expr.val.args) {
+          if (arg.tag != 'type') continue;
+          for (let generic of candidates) {
+            if (mentionsGeneric(arg.val, generic)) rejected.add(generic);
+          }
+        }
+      }
+      else if (expr.tag == 'fn_call' && expr.val.fn.tag == 'fn') {
+        checkCall(set, expr.val.fn, candidates, rejected);
+      }
+    },
+    leftExpr: leftExpr => {
+      checkType(leftExpr.type);
+      if (leftExpr.tag == 'index') {
+        let generic = isPtrTo(leftExpr.val.var.type);
+        if (generic != null) rejected.add(generic);
+      }
+      else if (leftExpr.tag == 'dot') {
+        let generic = isPtrTo(leftExpr.val.left.type);
+        if (generic != null) rejected.add(generic);
+      }
+      else if (leftExpr.tag == 'fn') {
+        // as a value its type has to match exactly
+        for (let generic of candidates) {
+          if (mentionsGeneric(leftExpr.type, generic)) rejected.add(generic);
+        }
+      }
+    }
+  });
+
+  // c in an include may only pass the pointer on as an argument
+  for (let [generic, names] of ptrNames) {
+    for (let name of names) {
+      let uses = new RegExp('(^|[^A-Za-z0-9_])_' + name + '(?![A-Za-z0-9_])', 'g');
+      let asArg = new RegExp('[(,]\\s*_' + name + '\\s*(?=[),])', 'g');
+      for (let line of includeLines) {
+        if ((line.match(uses) ?? []).length != (line.match(asArg) ?? []).length) rejected.add(generic);
+      }
+    }
+  }
+
+  for (let generic of candidates) {
+    if (!rejected.has(generic)) erasable.add(generic);
+  }
+  return erasable;
+}
+
+// a call passing a pointer to an erasable generic on has to hand it to a
+// generic the callee can erase as well
+function checkCall(set: FnSet, fn: LeftExpr, candidates: Set<string>, rejected: Set<string>) {
+  if (fn.tag != 'fn') return;
+  let passed = [...candidates].filter(generic => mentionsGeneric(fn.type, generic));
+  if (passed.length == 0) return;
+
+  let callee = getFnImpl(set, fn.fnReference);
+  if (callee == null || fn.mode == 'decl' || fn.mode == 'declImpl') {
+    for (let generic of passed) rejected.add(generic);
+    return;
+  }
+
+  let calleeType: Type = { tag: 'fn', paramTypes: fn.fnReference.paramTypes, returnType: fn.fnReference.returnType };
+  let calleeMap: Map<string, Type> = new Map();
+  typeApplicableStateful(fn.type, calleeType, calleeMap, new Map(), true, false);
+  let calleeErasable = erasableGenerics(set, callee);
+  for (let generic of passed) {
+    for (let [calleeGeneric, type] of calleeMap) {
+      if (!mentionsGeneric(type, generic)) continue;
+      if (type.tag != 'generic' || !calleeErasable.has(calleeGeneric)) rejected.add(generic);
+    }
+  }
+}
+
+function collectGenerics(type: Type, generics: Set<string>) {
+  if (type.tag == 'generic') generics.add(type.val);
+  else if (type.tag == 'ptr' || type.tag == 'link') collectGenerics(type.val, generics);
+  else if (type.tag == 'struct') {
+    for (let inner of type.val.generics) collectGenerics(inner, generics);
+  }
+  else if (type.tag == 'fn') {
+    collectGenerics(type.returnType, generics);
+    for (let inner of type.paramTypes) collectGenerics(inner, generics);
+  }
+}
+
+function mentionsGeneric(type: Type, generic: string): boolean {
+  let generics: Set<string> = new Set();
+  collectGenerics(type, generics);
+  return generics.has(generic);
+}
+
+// whether generic only shows up in type as the direct target of a pointer.
+// inside a struct or fn type it would change the c type
+function onlyBehindPtr(type: Type, generic: string): boolean {
+  if (type.tag == 'ptr' && type.val.tag == 'generic') return true;
+  if (type.tag == 'ptr' || type.tag == 'link') return onlyBehindPtr(type.val, generic);
+  return !mentionsGeneric(type, generic);
+}
+
 function addType(set: FnSet, type: Type) {
   let key = getTypeKey(type);
   if (set.types.has(key)) {
@@ -199,6 +372,7 @@ function monomorphizeFn(
   };
   let key = JSON.stringify(keyProps);
   set.fns.set(key, impl)
+  set.templates.set(impl, genericFn);
 
   return impl;
 }
@@ -234,9 +408,9 @@ function resolveInst(
     let body = resolveInstBody(inst.val, set, genericMap, constMap);
     return [{ tag: 'else', val: body, position: inst.position }];
   }
-  else if (inst.tag == 'defer') {
+  else if (inst.tag == 'defer' || inst.tag == 'arena') {
     let body = resolveInstBody(inst.val, set, genericMap, constMap);
-    return [{ tag: 'defer', val: body, position: inst.position }];
+    return [{ tag: inst.tag, val: body, position: inst.position }];
   }
   else if (inst.tag == 'for_in') {
     let iter = resolveExpr(inst.val.iter, set, genericMap, constMap, inst.position);
@@ -302,7 +476,8 @@ function resolveInst(
     let resolvedFn = resolveLeftExpr(nextFn, set, genericMap, constMap, inst.position);
     if (resolvedFn == null) return null;
 
-    return [{ tag: 'for_in', val: { varName: inst.val.varName, body, iter, nextFn: inst.val.nextFn, nextFnType: nfType }, position: inst.position }];
+    let resolvedType = applyConstMap(applyGenericMap(nfType, genericMap), constMap);
+    return [{ tag: 'for_in', val: { varName: inst.val.varName, body, iter, nextFn: inst.val.nextFn, nextFnType: resolvedType }, position: inst.position }];
   }
   else if (inst.tag == 'return') {
     if (inst.val != null) {
@@ -402,7 +577,7 @@ function implToExpr(
     isGeneric: impl.isGeneric
   };
 
-  fnExpr = resolveLeftExpr(fnExpr, set, genericMap, new Map(), position);
+  fnExpr = resolveLeftExpr(fnExpr, set, genericMap, new Map(), position, true);
   if (fnExpr == null) return null;
 
   if (impl.resolvedType.tag != 'fn') {
@@ -513,7 +688,7 @@ function resolveExpr(
 
     let genericCall = expr.val.fn.tag == 'fn' && expr.val.fn.isGeneric && !isGeneric(expr.val.fn.type);
     if (genericCall) set.genericCallStack.push(expr.val.position);
-    let fn = resolveLeftExpr(expr.val.fn, set, genericMap, constMap, position);
+    let fn = resolveLeftExpr(expr.val.fn, set, genericMap, constMap, position, true);
     if (genericCall) set.genericCallStack.pop();
 
     if (fn == null) return null;
@@ -547,15 +722,20 @@ function resolveExpr(
 
     let type = applyGenericMap(expr.type, genericMap);
     type = applyConstMap(type, constMap);
+    if (type.tag != 'struct') {
+      compilerError('expected list');
+      return null;
+    }
 
     // list init needs alloc to be available
     let allocRef: Fn = set.fnTemplates.get('alloc')!.find(x => x.header.paramTypes.length == 1 && x.header.unit == 'std/core')!.header;
     let allocMap = new Map();
 
-    allocMap.set('T', type);
+    let elemType = type.val.generics[0];
+    allocMap.set('T', elemType);
     let allocExpr: LeftExpr = {
       tag: 'fn',
-      type: { tag: 'fn', paramTypes: [INT], returnType: { tag: 'ptr', val: expr.type.val.generics[0], const: false } },
+      type: { tag: 'fn', paramTypes: [INT], returnType: { tag: 'ptr', val: elemType, const: false } },
       name: 'alloc',
       unit: 'std/core',
       mode: 'fn',
@@ -678,7 +858,8 @@ function resolveLeftExpr(
   set: FnSet,
   genericMap: Map<string, Type>,
   constMap: Map<string, string>,
-  position: Position | null
+  position: Position | null,
+  call: boolean = false
 ): LeftExpr | null {
   if (leftExpr.tag == 'fn') {
     let thisFnType = applyGenericMap(leftExpr.type, genericMap);
@@ -699,6 +880,26 @@ function resolveLeftExpr(
     let newConstMap = new Map();
     typeApplicableStateful(thisFnType, fnTemplateType, newGenericMap, newConstMap, true, false);
 
+    // a call passes its pointers to the one instance made with u8 in place
+    // of the erasable generics. c converts them implicitly, a fn used as a
+    // value keeps its own instance so its type stays exact
+    let template = getFnImpl(set, leftExpr.fnReference);
+    if (call && template != null && leftExpr.mode != 'decl') {
+      let erased = false;
+      for (let generic of erasableGenerics(set, template)) {
+        if (!newGenericMap.has(generic) || typeEq(newGenericMap.get(generic), U8)) continue;
+        newGenericMap.set(generic, U8);
+        erased = true;
+      }
+      if (erased) {
+        thisFnType = applyConstMap(applyGenericMap(fnTemplateType, newGenericMap), newConstMap);
+        if (thisFnType.tag != 'fn') {
+          compilerError('type should be fn');
+          return undefined!;
+        }
+      }
+    }
+
     // prevent reuse of recursive functions
     let keyProps: FnKey = {
       name: leftExpr.name,
@@ -745,7 +946,7 @@ function resolveLeftExpr(
     if (leftType.tag == 'ptr') {
       let type = applyGenericMap(leftExpr.type, genericMap);
       type = applyConstMap(type, constMap);
-      return { tag: 'index', val: { var: v, index, const: leftType.const, verifyFn: null, verifyFnType: null, implReturnsPointer: true }, type };
+      return { tag: 'index', val: { var: v, index, const: leftType.const, verifyFn: null, verifyFnType: null, implReturnsPointer: true, unchecked: leftExpr.val.unchecked }, type };
     }
 
     if (leftType.tag == 'struct'
@@ -755,7 +956,19 @@ function resolveLeftExpr(
     ) {
       let type = applyGenericMap(leftExpr.type, genericMap);
       type = applyConstMap(type, constMap);
-      return { tag: 'index', val: { var: v, index, const: false, verifyFn: null, verifyFnType: null, implReturnsPointer: false }, type };
+      return { tag: 'index', val: { var: v, index, const: false, verifyFn: null, verifyFnType: null, implReturnsPointer: false, unchecked: leftExpr.val.unchecked }, type };
+    }
+
+    // the base pointer is indexed directly, skipping the impl and its assert
+    if (leftExpr.val.unchecked && v.type.tag == 'struct') {
+      let baseField = getFields(v.type).find(field => field.name == 'base');
+      if (baseField != undefined) {
+        let baseType = baseField.type;
+        let base: Expr = { tag: 'left_expr', val: { tag: 'dot', val: { left: v, varName: 'base' }, type: baseType }, type: baseType };
+        let type = applyGenericMap(leftExpr.type, genericMap);
+        type = applyConstMap(type, constMap);
+        return { tag: 'index', val: { var: base, index, const: leftExpr.val.const, verifyFn: null, verifyFnType: null, implReturnsPointer: true, unchecked: true }, type };
+      }
     }
 
     // inner is the fnCall expr for index
@@ -794,7 +1007,8 @@ function resolveLeftExpr(
           const: leftExpr.val.const,
           verifyFn,
           verifyFnType,
-          implReturnsPointer: false
+          implReturnsPointer: false,
+          unchecked: false
         },
         type: inner.type
       }
@@ -808,7 +1022,8 @@ function resolveLeftExpr(
         const: leftExpr.val.const,
         verifyFn,
         verifyFnType,
-        implReturnsPointer: true
+        implReturnsPointer: true,
+        unchecked: false
       },
       type: inner.type.val
     }
@@ -0,0 +1,208 @@
+import fs from 'node:fs';
+import path from 'node:path';
+import { Program } from './replaceGenerics';
+import { FnInstance } from './codegen';
+
+export {
+  BuildStats, PassStart, newStats, passStart, addPass, addUnitTime,
+  addProgram, addInstances, addObject, setClangTime, printStats, writeStats,
+  InstanceGroup, groupInstances, formatBytes
+}
+
+interface PassStat {
+  name: string
+  ms: number
+  // heap in use once the pass is done, and how much it grew during it. the
+  // growth is negative when the gc ran in between
+  heapBytes: number
+  heapGrowth: number
+}
+
+interface UnitStat {
+  name: string
+  parseMs: number
+  parseCached: boolean
+  // null for headers, they are only loaded
+  analyzeMs: number | null
+  heapGrowth: number
+}
+
+interface ObjectStat {
+  file: string
+  cBytes: number
+  // null when the object was reused from the cache
+  clangMs: number | null
+}
+
+// the instances generics made of one fn
+interface InstanceGroup {
+  name: string
+  instances: number
+  cBytes: number
+}
+
+interface BuildStats {
+  output: string
+  passes: PassStat[]
+  units: UnitStat[]
+  fns: number
+  sourceFns: number
+  instances: InstanceGroup[]
+  types: number
+  cBytes: number
+  cFiles: number
+  objects: ObjectStat[]
+  totalMs: number
+  start: PassStart
+}
+
+interface PassStart {
+  time: number
+  heap: number
+}
+
+function passStart(): PassStart {
+  return { time: performance.now(), heap: process.memoryUsage().heapUsed };
+}
+
+function newStats(output: string): BuildStats {
+  return {
+    output,
+    passes: [],
+    units: [],
+    fns: 0,
+    sourceFns: 0,
+    instances: [],
+    types: 0,
+    cBytes: 0,
+    cFiles: 0,
+    objects: [],
+    totalMs: 0,
+    start: passStart()
+  };
+}
+
+function addPass(stats: BuildStats | null, name: string, start: PassStart) {
+  if (stats == null) return;
+  let heapBytes = process.memoryUsage().heapUsed;
+  let now = performance.now();
+  stats.passes.push({ name, ms: now - start.time, heapBytes, heapGrowth: heapBytes - start.heap });
+  stats.totalMs = now - stats.start.time;
+}
+
+function addUnitTime(stats: BuildStats | null, name: string, step: 'parse' | 'analyze', start: PassStart, cached: boolean = false) {
+  if (stats == null) return;
+  let unit = stats.units.find(x => x.name == name);
+  if (unit == undefined) {
+    unit = { name, parseMs: 0, parseCached: false, analyzeMs: null, heapGrowth: 0 };
+    stats.units.push(unit);
+  }
+
+  let ms = performance.now() - start.time;
+  if (step == 'parse') {
+    unit.parseMs = ms;
+    unit.parseCached = cached;
+  }
+  else {
+    unit.analyzeMs = ms;
+  }
+  unit.heapGrowth += process.memoryUsage().heapUsed - start.heap;
+}
+
+// every instance of a generic fn is counted in fns, sourceFns counts the
+// fns they were made from, each overload on its own
+function addProgram(stats: BuildStats | null, program: Program) {
+  if (stats == null) return;
+  stats.fns = program.fns.length;
+  stats.sourceFns = new Set(program.fns.map(fn => program.templates.get(fn) ?? fn)).size;
+  stats.types = program.orderedTypes.length;
+}
+
+function addInstances(stats: BuildStats | null, instances: FnInstance[]) {
+  if (stats == null) return;
+  stats.instances = groupInstances(instances);
+}
+
+// largest first
+function groupInstances(instances: FnInstance[]): InstanceGroup[] {
+  let groups: Map<string, InstanceGroup> = new Map();
+  for (let instance of instances) {
+    let name = instance.template;
+    let group = groups.get(name);
+    if (group == undefined) {
+      group = { name, instances: 0, cBytes: 0 };
+      groups.set(name, group);
+    }
+    group.instances += 1;
+    group.cBytes += instance.bytes;
+  }
+  return Array.from(groups.values()).sort((a, b) => b.cBytes - a.cBytes || (a.name < b.name ? -1 : 1));
+}
+
+function addObject(stats: BuildStats | null, file: string, cBytes: number) {
+  if (stats == null) return;
+  stats.objects.push({ file, cBytes, clangMs: null });
+}
+
+function setClangTime(stats: BuildStats | null, file: string, ms: number) {
+  if (stats == null) return;
+  let object = stats.objects.find(x => x.file == file);
+  if (object != undefined) object.clangMs = ms;
+}
+
+function formatMs(ms: number): string {
+  return ms.toFixed(ms < 10 ? 1 : 0) + 'ms';
+}
+
+function formatBytes(bytes: number): string {
+  if (Math.abs(bytes) >= 1024 * 1024) return (bytes / 1024 / 1024).toFixed(1) + 'MB';
+  if (Math.abs(bytes) >= 1024) return (bytes / 1024).toFixed(1) + 'KB';
+  return bytes + 'B';
+}
+
+function printStats(stats: BuildStats) {
+  let rows = (table: string[][]) => {
+    let widths = table[0].map((_, i) => Math.max(...table.map(row => row[i].length)));
+    for (let row of table) {
+      console.log(row.map((cell, i) => i == 0 ? cell.padEnd(widths[i]) : cell.padStart(widths[i])).join('  '));
+    }
+  };
+
+  console.log(`passes for ${stats.output}`);
+  let passes = [['pass', 'time', 'heap', 'growth']];
+  for (let pass of stats.passes) {
+    passes.push([pass.name, formatMs(pass.ms), formatBytes(pass.heapBytes), formatBytes(pass.heapGrowth)]);
+  }
+  passes.push(['total', formatMs(stats.totalMs), '', '']);
+  rows(passes);
+
+  // slowest units first, they are the ones worth looking at
+  let units = [['unit', 'parse', 'analyze', 'growth']];
+  let unitMs = (unit: UnitStat) => unit.parseMs + (unit.analyzeMs ?? 0);
+  let sorted = [...stats.units].sort((a, b) => unitMs(b) - unitMs(a));
+  for (let unit of sorted) {
+    let parse = unit.parseCached ? 'cached' : formatMs(unit.parseMs);
+    let analyze = unit.analyzeMs == null ? '-' : formatMs(unit.analyzeMs);
+    units.push([unit.name, parse, analyze, formatBytes(unit.heapGrowth)]);
+  }
+  console.log();
+  rows(units);
+
+  console.log();
+  console.log(`${stats.fns} fns emitted from ${stats.sourceFns} source fns, ${stats.types} types`);
+  let compiled = stats.objects.filter(x => x.clangMs != null);
+  console.log(`${formatBytes(stats.cBytes)} of c in ${stats.cFiles} files, ${compiled.length} of ${stats.objects.length} objects compiled by clang`);
+  if (compiled.length > 0) {
+    let objects = [['file', 'c', 'clang']];
+    for (let object of compiled.sort((a, b) => b.clangMs! - a.clangMs!)) {
+      objects.push([object.file, formatBytes(object.cBytes), formatMs(object.clangMs!)]);
+    }
+    rows(objects);
+  }
+}
+
+function writeStats(stats: BuildStats, filePath: string) {
+  let { start, ...report } = stats;
+  fs.mkdirSync(path.dirname(filePath), { recursive: true });
+  fs.writeFileSync(filePath, JSON.stringify(report, null, 2));
+}
@@ -353,7 +353,7 @@ function createArr(t1: Type): Type {
         modifier: 'pub',
         structMode: 'struct',
         fields: [
-          { name: 'base', type: { tag: 'ptr', val: t1, const: false }, modifier: 'get' },
+          { name: 'base', type: { tag: 'ptr', val: { tag: 'generic', val: 'T' }, const: false }, modifier: 'get' },
           { name: 'len', type: INT, modifier: 'get' },
           { name: 'capacity', type: INT, modifier: 'get' }
         ],